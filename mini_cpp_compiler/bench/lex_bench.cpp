@@ -0,0 +1,119 @@
+// Lexer scanning microbenchmark.
+//
+// Build (from mini_cpp_compiler/):
+//   g++ -std=c++17 -O2 -pthread bench/lex_bench.cpp lexer.cpp scan.cpp source.cpp intern.cpp -I. -o lex_bench
+// Run:
+//   lex_bench [megabytes]
+//
+// For a comment-heavy and an identifier-heavy synthetic input, reports the
+// throughput of each raw scanner and of a full Lexer::tokenize() pass for
+// every scanner implementation this CPU supports, then the scaling of
+// Lexer::tokenizeParallel() with the thread count.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lexer.h"
+#include "scan.h"
+
+using namespace std;
+
+static string makeCommentHeavy(size_t bytes) {
+    string s = "int main() {\n";
+    size_t i = 0;
+    while (s.size() < bytes) {
+        s += "    // line comment number " + to_string(i) + " with some words in it ......\n";
+        s += "    /* block comment: the quick brown fox jumps over the lazy dog * / *\n"
+             "       spanning two lines " + to_string(i) + " */\n";
+        s += "    x = x + 1;\n";
+        i++;
+    }
+    s += "    return x;\n}\n";
+    return s;
+}
+
+static string makeIdentHeavy(size_t bytes) {
+    string s = "int main() {\n";
+    size_t i = 0;
+    while (s.size() < bytes) {
+        s += "    int generated_identifier_name_" + to_string(i) +
+             " = another_fairly_long_variable_name_" + to_string(i % 97) +
+             " * 1234567.25 + yet_another_name;\n";
+        i++;
+    }
+    s += "    return 0;\n}\n";
+    return s;
+}
+
+template <typename F>
+static double secondsFor(F &&fn, int reps) {
+    auto t0 = chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) fn();
+    auto t1 = chrono::steady_clock::now();
+    return chrono::duration<double>(t1 - t0).count() / reps;
+}
+
+// Walk the whole buffer with one scanner, skipping one byte at every stop
+static size_t sweep(size_t (*fn)(const char *, size_t), const string &s) {
+    size_t pos = 0, stops = 0;
+    while (pos < s.size()) {
+        pos += fn(s.data() + pos, s.size() - pos) + 1;
+        stops++;
+    }
+    return stops;
+}
+
+static void report(const char *what, const char *impl, size_t bytes, double sec) {
+    printf("  %-22s %-7s %9.1f MB/s\n", what, impl, bytes / sec / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 32;
+    const int reps = 5;
+
+    struct Input { const char *name; bool comments; string text; };
+    vector<Input> inputs = {
+        {"comment-heavy", true, makeCommentHeavy(mb << 20)},
+        {"identifier-heavy", false, makeIdentHeavy(mb << 20)},
+    };
+
+    vector<const ScanOps *> impls;
+    for (const char *n : {"scalar", "sse2", "avx2"})
+        if (const ScanOps *ops = findScanOps(n)) impls.push_back(ops);
+
+    volatile size_t sink = 0;
+    for (auto &in : inputs) {
+        printf("%s (%zu bytes)\n", in.name, in.text.size());
+        for (auto *ops : impls) {
+            if (in.comments) {
+                report("findNewline", ops->name, in.text.size(),
+                       secondsFor([&] { sink = sink + sweep(ops->findNewline, in.text); }, reps));
+                report("findCommentEnd", ops->name, in.text.size(),
+                       secondsFor([&] { sink = sink + sweep(ops->findCommentEnd, in.text); }, reps));
+            } else {
+                report("identRun", ops->name, in.text.size(),
+                       secondsFor([&] { sink = sink + sweep(ops->identRun, in.text); }, reps));
+            }
+        }
+        for (auto *ops : impls) {
+            setScanOps(*ops);
+            report("Lexer::tokenize", ops->name, in.text.size(), secondsFor([&] {
+                Lexer lexer(in.text);
+                sink = sink + lexer.tokenize().size();
+            }, reps));
+        }
+        unsigned cores = max(1u, thread::hardware_concurrency());
+        for (unsigned t = 1; t <= cores; t *= 2) {
+            string label = "tokenizeParallel x" + to_string(t);
+            report(label.c_str(), "", in.text.size(), secondsFor([&] {
+                Lexer lexer(in.text);
+                sink = sink + lexer.tokenizeParallel(t).size();
+            }, reps));
+        }
+    }
+    return 0;
+}
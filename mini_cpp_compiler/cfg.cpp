@@ -0,0 +1,115 @@
+#include "cfg.h"
+#include <utility>
+
+using namespace std;
+
+CFG::CFG(const vector<Quad> &code) {
+    size_t n = code.size();
+    blockOf.assign(n, 0);
+    if (n == 0) return;
+
+    // Leaders: first instruction, labels, and whatever follows a jump
+    vector<char> leader(n, 0);
+    leader[0] = 1;
+    for (size_t i = 0; i < n; ++i) {
+        Opcode op = code[i].op;
+        if (op == Opcode::Label) leader[i] = 1;
+        if ((op == Opcode::Goto || isCondJump(op) || op == Opcode::Return) && i + 1 < n)
+            leader[i + 1] = 1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (leader[i]) blocks.push_back({(uint32_t)i, (uint32_t)i, {}, {}});
+        blockOf[i] = (uint32_t)blocks.size() - 1;
+        blocks.back().last = (uint32_t)i + 1;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (code[i].op != Opcode::Label) continue;
+        uint32_t id = code[i].a.id;
+        if (id >= labelBlock.size()) labelBlock.resize(id + 1, -1);
+        labelBlock[id] = (int32_t)blockOf[i];
+    }
+
+    auto addEdge = [&](uint32_t from, int32_t to) {
+        if (to < 0) return;
+        for (uint32_t s : blocks[from].succs)
+            if (s == (uint32_t)to) return;
+        blocks[from].succs.push_back((uint32_t)to);
+        blocks[to].preds.push_back(from);
+    };
+    for (uint32_t b = 0; b < blocks.size(); ++b) {
+        const Quad &end = code[blocks[b].last - 1];
+        bool fallsThrough = true;
+        if (end.op == Opcode::Goto) {
+            addEdge(b, labelTarget(end.a));
+            fallsThrough = false;
+        } else if (isCondJump(end.op)) {
+            addEdge(b, labelTarget(end.b));
+        } else if (end.op == Opcode::Return) {
+            fallsThrough = false;
+        }
+        if (fallsThrough && b + 1 < blocks.size()) addEdge(b, (int32_t)b + 1);
+    }
+}
+
+vector<uint32_t> CFG::reversePostOrder() const {
+    vector<uint32_t> order;
+    if (blocks.empty()) return order;
+
+    // iterative DFS: (block, next successor)
+    vector<char> seen(blocks.size(), 0);
+    vector<pair<uint32_t, size_t>> stack{{0, 0}};
+    seen[0] = 1;
+    while (!stack.empty()) {
+        auto &[b, next] = stack.back();
+        if (next < blocks[b].succs.size()) {
+            uint32_t s = blocks[b].succs[next++];
+            if (!seen[s]) {
+                seen[s] = 1;
+                stack.push_back({s, 0});
+            }
+            continue;
+        }
+        order.push_back(b);
+        stack.pop_back();
+    }
+    return vector<uint32_t>(order.rbegin(), order.rend());
+}
+
+// Cooper, Harvey & Kennedy: iterate over reverse post-order, intersecting
+// the dominator-tree paths of the already processed predecessors
+vector<int32_t> CFG::immediateDominators() const {
+    vector<int32_t> idom(blocks.size(), -1);
+    if (blocks.empty()) return idom;
+
+    vector<uint32_t> order = reversePostOrder();
+    vector<uint32_t> rank(blocks.size(), 0);
+    for (uint32_t k = 0; k < order.size(); ++k) rank[order[k]] = k;
+
+    auto intersect = [&](uint32_t x, uint32_t y) {
+        while (x != y) {
+            while (rank[x] > rank[y]) x = (uint32_t)idom[x];
+            while (rank[y] > rank[x]) y = (uint32_t)idom[y];
+        }
+        return x;
+    };
+
+    idom[0] = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (uint32_t k = 1; k < order.size(); ++k) {
+            uint32_t b = order[k];
+            int32_t best = -1;
+            for (uint32_t p : blocks[b].preds) {
+                if (idom[p] < 0) continue;
+                best = best < 0 ? (int32_t)p : (int32_t)intersect((uint32_t)best, p);
+            }
+            if (best != idom[b]) {
+                idom[b] = best;
+                changed = true;
+            }
+        }
+    }
+    return idom;
+}
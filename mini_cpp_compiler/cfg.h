@@ -0,0 +1,43 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <cstdint>
+#include <vector>
+#include "tac.h"
+
+// Control-flow graph of a TAC function.
+// - A block starts at the first instruction, at every label and after
+//   every goto / conditional jump / return, and ends before the next
+//   such point.
+// - Block 0 is the entry; blocks are numbered in code order.
+// - A return ends the function: its block has no successors.
+struct BasicBlock {
+    uint32_t first, last;             // instructions [first, last)
+    std::vector<uint32_t> succs;
+    std::vector<uint32_t> preds;
+};
+
+class CFG {
+public:
+    explicit CFG(const std::vector<Quad> &code);
+
+    std::vector<BasicBlock> blocks;
+    std::vector<uint32_t> blockOf;    // instruction -> its block
+
+    size_t size() const { return blocks.size(); }
+    // Block a label starts, -1 if the label is not defined
+    int32_t labelTarget(const Operand &label) const {
+        return label.id < labelBlock.size() ? labelBlock[label.id] : -1;
+    }
+    // Blocks reachable from the entry in reverse post-order (the natural
+    // visiting order of forward problems; reversed for backward ones)
+    std::vector<uint32_t> reversePostOrder() const;
+    // Immediate dominator of every block (the entry is its own, -1 for
+    // unreachable blocks)
+    std::vector<int32_t> immediateDominators() const;
+
+private:
+    std::vector<int32_t> labelBlock;  // label number -> block it starts
+};
+
+#endif // CFG_H
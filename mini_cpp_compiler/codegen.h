@@ -1,15 +1,28 @@
-#ifndef CODEGEN_H
-#define CODEGEN_H
-
-#include <string>
-#include <vector>
-
-class CodeGen {
-public:
-    // Generate pseudo-assembly from TAC lines
-    // Input: tac (vector of TAC strings like "t1 = a + b", "if t1 goto L1", "L1:", "return a")
-    // Output: assembly-like lines (MOV/ADD/SUB/MUL/DIV/CMP/JNE/JMP/LABEL/RETURN)
-    std::vector<std::string> generate(const std::vector<std::string> &tac);
-};
-
-#endif // CODEGEN_H
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include <vector>
+#include "tac.h"
+#include "machine.h"
+
+class CodeGen {
+public:
+    // `registers`: size of the register file (two are kept as scratch)
+    // `peephole`: run the peephole optimizer over the result (machine.h)
+    explicit CodeGen(int registers = 8, bool peephole = true)
+        : registers(registers), runPeephole(peephole) {}
+
+    // Generate machine instructions from TAC
+    // Input: tac (quads like %t1 = a + b, if %t1 goto L1, L1:, return a)
+    // Output: MOV/ADD/SUB/MUL/DIV/CMP/Jcc/JMP/label/RETURN instructions;
+    // formatAssembly() turns them into pseudo-assembly text
+    // Temporaries and variables get registers from a linear-scan
+    // allocator (see regalloc.h); what does not fit stays in memory
+    MachineFunction generate(const std::vector<Quad> &tac);
+
+private:
+    int registers;
+    bool runPeephole;
+};
+
+#endif // CODEGEN_H
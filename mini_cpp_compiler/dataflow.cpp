@@ -0,0 +1,307 @@
+#include "dataflow.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+using namespace std;
+
+// -----------------------------
+// BitVector
+// -----------------------------
+bool BitVector::unionWith(const BitVector &o) {
+    bool changed = false;
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t v = words[w] | o.words[w];
+        changed |= (v != words[w]);
+        words[w] = v;
+    }
+    return changed;
+}
+
+bool BitVector::intersectWith(const BitVector &o) {
+    bool changed = false;
+    for (size_t w = 0; w < words.size(); ++w) {
+        uint64_t v = words[w] & o.words[w];
+        changed |= (v != words[w]);
+        words[w] = v;
+    }
+    return changed;
+}
+
+void BitVector::subtract(const BitVector &o) {
+    for (size_t w = 0; w < words.size(); ++w) words[w] &= ~o.words[w];
+}
+
+// -----------------------------
+// Solver
+// -----------------------------
+DataflowResult solveDataflow(const CFG &cfg, const DataflowProblem &p) {
+    size_t n = cfg.size();
+    bool forward = (p.direction == FlowDirection::Forward);
+    bool must = (p.meet == FlowMeet::Must);
+
+    DataflowResult r;
+    r.in.assign(n, BitVector(p.bits, must));
+    r.out.assign(n, BitVector(p.bits, must));
+
+    // Reverse post-order for forward problems, post-order for backward
+    // ones; unreachable blocks go last so every block gets a value
+    vector<uint32_t> order = cfg.reversePostOrder();
+    vector<char> listed(n, 0);
+    for (uint32_t b : order) listed[b] = 1;
+    for (uint32_t b = 0; b < n; ++b)
+        if (!listed[b]) order.push_back(b);
+    if (!forward) reverse(order.begin(), order.end());
+
+    // Worklist seeded in that order: a block is looked at again only when
+    // a block it depends on changed (on an acyclic CFG each block once)
+    deque<uint32_t> work(order.begin(), order.end());
+    vector<char> queued(n, 1);
+    const BitVector top(p.bits, must);
+    BitVector result;
+    while (!work.empty()) {
+        uint32_t b = work.front();
+        work.pop_front();
+        queued[b] = 0;
+        const BasicBlock &bb = cfg.blocks[b];
+        const vector<uint32_t> &edges = forward ? bb.preds : bb.succs;
+        bool atBoundary = forward ? (b == 0) : bb.succs.empty();
+
+        BitVector &meet = forward ? r.in[b] : r.out[b];
+        meet = atBoundary ? p.boundary : top;
+        for (uint32_t e : edges) {
+            const BitVector &v = forward ? r.out[e] : r.in[e];
+            if (must) meet.intersectWith(v);
+            else meet.unionWith(v);
+        }
+
+        result = meet;
+        result.subtract(p.kill[b]);
+        result.unionWith(p.gen[b]);
+
+        BitVector &old = forward ? r.out[b] : r.in[b];
+        if (result == old) continue;
+        swap(old, result);
+        for (uint32_t d : forward ? bb.succs : bb.preds) {
+            if (queued[d]) continue;
+            queued[d] = 1;
+            work.push_back(d);
+        }
+    }
+    return r;
+}
+
+// -----------------------------
+// Operand numbering
+// -----------------------------
+OperandIndex::OperandIndex(const vector<Quad> &code) : varSlots(16, VarSlot{0, -1}) {
+    for (const Quad &q : code) {
+        for (const Operand *o : {&q.dst, &q.a, &q.b}) {
+            if (o->kind == OperandKind::Temp) {
+                if (o->id >= tempBit.size()) tempBit.resize(o->id + 1, -1);
+                if (tempBit[o->id] < 0) tempBit[o->id] = (int32_t)count++;
+            } else if (o->kind == OperandKind::Var) {
+                size_t i = slotOf(o->id);
+                if (varSlots[i].id != 0) continue;
+                varSlots[i] = {o->id, (int32_t)count++};
+                if (++vars * 2 > varSlots.size()) {
+                    vector<VarSlot> old(varSlots.size() * 2, VarSlot{0, -1});
+                    old.swap(varSlots);
+                    for (const VarSlot &v : old)
+                        if (v.id != 0) varSlots[slotOf(v.id)] = v;
+                }
+            }
+        }
+    }
+}
+
+OperandIndex::OperandIndex(const OperandIndex &all, const vector<char> &keep)
+    : tempBit(all.tempBit), varSlots(all.varSlots), vars(all.vars) {
+    vector<int32_t> renumbered(all.size(), -1);
+    for (size_t b = 0; b < all.size(); ++b)
+        if (keep[b]) renumbered[b] = (int32_t)count++;
+    for (int32_t &bit : tempBit)
+        if (bit >= 0) bit = renumbered[bit];
+    for (VarSlot &v : varSlots)
+        if (v.id != 0) v.bit = renumbered[v.bit];
+}
+
+// -----------------------------
+// Analyses
+// -----------------------------
+namespace {
+
+// Bits listed per variable (its definitions, the expressions reading
+// it). A variable assigned all over the function has a long list; it is
+// also kept as a bit vector, built on first use, so that dropping its
+// bits from a block's sets costs words rather than one step per bit.
+class BitsPerVariable {
+public:
+    BitsPerVariable(vector<vector<uint32_t>> lists, size_t bits)
+        : lists(std::move(lists)), masks(this->lists.size()), bits(bits) {}
+
+    // gen -= bits of v, kill |= bits of v
+    void removeFrom(uint32_t v, BitVector &gen, BitVector &kill) {
+        const vector<uint32_t> &list = lists[v];
+        if (list.size() <= 64) {
+            for (uint32_t bit : list) {
+                gen.reset(bit);
+                kill.set(bit);
+            }
+            return;
+        }
+        if (masks[v].size() == 0) {
+            masks[v] = BitVector(bits);
+            for (uint32_t bit : list) masks[v].set(bit);
+        }
+        gen.subtract(masks[v]);
+        kill.unionWith(masks[v]);
+    }
+
+private:
+    vector<vector<uint32_t>> lists;
+    vector<BitVector> masks;
+    size_t bits;
+};
+
+} // namespace
+
+DataflowResult liveVariables(const vector<Quad> &code, const CFG &cfg, const OperandIndex &vars) {
+    DataflowProblem p{FlowDirection::Backward, FlowMeet::May, vars.size(), {}, {}, BitVector(vars.size())};
+    p.gen.assign(cfg.size(), BitVector(vars.size()));
+    p.kill.assign(cfg.size(), BitVector(vars.size()));
+
+    // gen: read before any write in the block; kill: written in the block
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].last; ++i) {
+            const Quad &q = code[i];
+            for (const Operand *o : {&q.a, &q.b}) {
+                int32_t v = vars.of(*o);
+                if (v >= 0 && !p.kill[b].test(v)) p.gen[b].set(v);
+            }
+            int32_t d = assignsValue(q) ? vars.of(q.dst) : -1;
+            if (d >= 0) p.kill[b].set(d);
+        }
+    }
+    return solveDataflow(cfg, p);
+}
+
+DataflowResult reachingDefinitions(const vector<Quad> &code, const CFG &cfg, vector<uint32_t> &defs,
+                                   const vector<Operand> *only) {
+    OperandIndex vars(code);
+    vector<char> wanted(vars.size(), only ? 0 : 1);
+    if (only)
+        for (const Operand &o : *only)
+            if (vars.of(o) >= 0) wanted[vars.of(o)] = 1;
+    auto defined = [&](const Quad &q) {
+        int32_t d = assignsValue(q) ? vars.of(q.dst) : -1;
+        return (d >= 0 && wanted[d]) ? d : -1;
+    };
+
+    vector<vector<uint32_t>> lists(vars.size());
+    defs.clear();
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        int32_t d = defined(code[i]);
+        if (d < 0) continue;
+        lists[d].push_back((uint32_t)defs.size());
+        defs.push_back(i);
+    }
+
+    size_t bits = defs.size();
+    BitsPerVariable defsOf(std::move(lists), bits);   // variable -> its definitions
+
+    DataflowProblem p{FlowDirection::Forward, FlowMeet::May, bits, {}, {}, BitVector(bits)};
+    p.gen.assign(cfg.size(), BitVector(bits));
+    p.kill.assign(cfg.size(), BitVector(bits));
+
+    // gen: the last definition of each variable in the block; kill: every
+    // definition of a variable the block assigns
+    uint32_t next = 0;   // bit of the next definition, in code order
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].last; ++i) {
+            int32_t d = defined(code[i]);
+            if (d < 0) continue;
+            defsOf.removeFrom((uint32_t)d, p.gen[b], p.kill[b]);
+            p.gen[b].set(next++);
+        }
+    }
+    return solveDataflow(cfg, p);
+}
+
+namespace {
+
+// Identity of "a op b" (commutative operands are not reordered)
+struct ExprKey {
+    Opcode op;
+    OperandKind ka, kb;
+    uint64_t va, vb;
+    bool operator==(const ExprKey &o) const {
+        return op == o.op && ka == o.ka && kb == o.kb && va == o.va && vb == o.vb;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey &k) const {
+        uint64_t h = (uint64_t)k.op * 0x9E3779B97F4A7C15ull;
+        h ^= ((uint64_t)k.ka << 8 | (uint64_t)k.kb) + (h << 6) + (h >> 2);
+        h ^= k.va * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+        h ^= k.vb * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+        return (size_t)h;
+    }
+};
+
+uint64_t operandBits(const Operand &o) {
+    if (o.kind == OperandKind::Int) return (uint64_t)o.i;
+    if (o.kind == OperandKind::Float) {
+        uint64_t v;
+        memcpy(&v, &o.f, sizeof v);
+        return v;
+    }
+    return o.id;
+}
+
+} // namespace
+
+DataflowResult availableExpressions(const vector<Quad> &code, const CFG &cfg, vector<uint32_t> &exprs,
+                                    vector<uint32_t> *exprOfOut) {
+    OperandIndex vars(code);
+    unordered_map<ExprKey, uint32_t, ExprKeyHash> bitOf;
+    vector<uint32_t> local;
+    vector<uint32_t> &exprOf = exprOfOut ? *exprOfOut : local;   // instruction -> its expression
+    exprOf.assign(code.size(), UINT32_MAX);
+    vector<vector<uint32_t>> usersOf(vars.size());       // variable -> expressions reading it
+    exprs.clear();
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        const Quad &q = code[i];
+        if (!isBinary(q.op)) continue;
+        ExprKey key{q.op, q.a.kind, q.b.kind, operandBits(q.a), operandBits(q.b)};
+        auto [it, fresh] = bitOf.emplace(key, (uint32_t)exprs.size());
+        exprOf[i] = it->second;
+        if (!fresh) continue;
+        exprs.push_back(i);
+        for (const Operand *o : {&q.a, &q.b}) {
+            int32_t v = vars.of(*o);
+            if (v >= 0 && (usersOf[v].empty() || usersOf[v].back() != it->second))
+                usersOf[v].push_back(it->second);
+        }
+    }
+
+    size_t bits = exprs.size();
+    BitsPerVariable users(std::move(usersOf), bits);
+    DataflowProblem p{FlowDirection::Forward, FlowMeet::Must, bits, {}, {}, BitVector(bits)};
+    p.gen.assign(cfg.size(), BitVector(bits));
+    p.kill.assign(cfg.size(), BitVector(bits));
+
+    // gen: computed and not overwritten afterwards in the block; kill:
+    // reads a variable the block assigns
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].last; ++i) {
+            if (exprOf[i] != UINT32_MAX) p.gen[b].set(exprOf[i]);
+            int32_t d = assignsValue(code[i]) ? vars.of(code[i].dst) : -1;
+            if (d < 0) continue;
+            users.removeFrom((uint32_t)d, p.gen[b], p.kill[b]);
+        }
+    }
+    return solveDataflow(cfg, p);
+}
@@ -0,0 +1,127 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <cstdint>
+#include <vector>
+#include "tac.h"
+#include "cfg.h"
+
+// Fixed-size set of small integers, 64 per word
+class BitVector {
+public:
+    BitVector(size_t bits = 0, bool value = false)
+        : words((bits + 63) / 64, value ? ~0ull : 0), nbits(bits) { trim(); }
+
+    size_t size() const { return nbits; }
+    bool test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void set(size_t i) { words[i >> 6] |= 1ull << (i & 63); }
+    void reset(size_t i) { words[i >> 6] &= ~(1ull << (i & 63)); }
+
+    // In-place set operations; true if this set changed
+    bool unionWith(const BitVector &o);
+    bool intersectWith(const BitVector &o);
+    void subtract(const BitVector &o);
+
+    bool operator==(const BitVector &o) const { return words == o.words; }
+    bool operator!=(const BitVector &o) const { return words != o.words; }
+
+    template <class F> void forEach(F f) const {
+        for (size_t w = 0; w < words.size(); ++w)
+            for (uint64_t bits = words[w]; bits; bits &= bits - 1)
+                f(w * 64 + __builtin_ctzll(bits));
+    }
+
+private:
+    std::vector<uint64_t> words;
+    size_t nbits;
+
+    void trim() { if (nbits & 63) words.back() &= (1ull << (nbits & 63)) - 1; }
+};
+
+// Generic iterative bit-vector dataflow over a CFG.
+// - Forward:  in[b] = meet(out[p] for preds p),  out[b] = gen[b] | (in[b] - kill[b])
+// - Backward: out[b] = meet(in[s] for succs s),  in[b] = gen[b] | (out[b] - kill[b])
+// - May problems meet with union (start empty), Must problems with
+//   intersection (start full); `boundary` is the value at the entry
+//   (forward) or at the exits (backward).
+enum class FlowDirection : uint8_t { Forward, Backward };
+enum class FlowMeet : uint8_t { May, Must };
+
+struct DataflowProblem {
+    FlowDirection direction;
+    FlowMeet meet;
+    size_t bits;
+    std::vector<BitVector> gen, kill;     // per block
+    BitVector boundary;
+};
+
+struct DataflowResult {
+    std::vector<BitVector> in, out;       // per block
+};
+
+DataflowResult solveDataflow(const CFG &cfg, const DataflowProblem &problem);
+
+// Dense numbering of the variables and temporaries a TAC function uses.
+// Temps are numbered from 1 in each function and index a table directly;
+// variables are SymbolIds, interned program-wide, so they are looked up in
+// an open-addressing table sized by the function's own variables.
+class OperandIndex {
+public:
+    explicit OperandIndex(const std::vector<Quad> &code);
+    // The operands of `all` whose bit is set in `keep`, renumbered densely
+    // (in the order of their bits in `all`)
+    OperandIndex(const OperandIndex &all, const std::vector<char> &keep);
+    // Bit of a Var/Temp operand, -1 for anything else
+    int32_t of(const Operand &o) const {
+        if (o.kind == OperandKind::Temp) return o.id < tempBit.size() ? tempBit[o.id] : -1;
+        if (o.kind == OperandKind::Var) {
+            const VarSlot &s = varSlots[slotOf(o.id)];
+            return s.id == o.id ? s.bit : -1;
+        }
+        return -1;
+    }
+    size_t size() const { return count; }
+
+private:
+    struct VarSlot {
+        uint32_t id;          // SymbolId, 0 = free
+        int32_t bit;
+    };
+
+    std::vector<int32_t> tempBit;
+    std::vector<VarSlot> varSlots;    // power-of-two size, linear probing
+    size_t vars = 0;
+    size_t count = 0;
+
+    // The variable's slot, or the free slot to use
+    size_t slotOf(uint32_t id) const {
+        size_t mask = varSlots.size() - 1;
+        size_t i = (id * 2654435761u) & mask;
+        while (varSlots[i].id != 0 && varSlots[i].id != id) i = (i + 1) & mask;
+        return i;
+    }
+};
+
+// Does the instruction assign its dst (copy or binary operation)?
+inline bool assignsValue(const Quad &q) { return q.op == Opcode::Copy || isBinary(q.op); }
+
+// ---- Analyses built on the framework ----
+
+// Live variables (backward, may): bits of `vars`
+DataflowResult liveVariables(const std::vector<Quad> &code, const CFG &cfg, const OperandIndex &vars);
+
+// Reaching definitions (forward, may): bit i is the assignment at
+// instruction defs[i]; with `only`, just the assignments of those
+// variables/temps get bits
+DataflowResult reachingDefinitions(const std::vector<Quad> &code, const CFG &cfg,
+                                   std::vector<uint32_t> &defs,
+                                   const std::vector<Operand> *only = nullptr);
+
+// Available expressions (forward, must): bit i is the expression
+// "a op b" computed by instruction exprs[i] (and any identical one);
+// `exprOf`, if given, gets each instruction's bit (UINT32_MAX: none)
+DataflowResult availableExpressions(const std::vector<Quad> &code, const CFG &cfg,
+                                    std::vector<uint32_t> &exprs,
+                                    std::vector<uint32_t> *exprOf = nullptr);
+
+#endif // DATAFLOW_H
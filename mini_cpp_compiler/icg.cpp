@@ -1,137 +1,202 @@
-#include "icg.h"
-#include <sstream>
-
-using namespace std;
-
-ICGGenerator::ICGGenerator() {
-    tempCount = 0;
-    labelCount = 0;
-    code.clear();
-}
-
-void ICGGenerator::reset() {
-    tempCount = 0;
-    labelCount = 0;
-    code.clear();
-}
-
-string ICGGenerator::newTemp() {
-    return "t" + to_string(++tempCount);
-}
-
-string ICGGenerator::newLabel() {
-    return "L" + to_string(++labelCount);
-}
-
-string ICGGenerator::genExpr(const shared_ptr<ASTNode> &node) {
-    if (!node) return "";
-
-    // Number literal or variable
-    if (node->kind == "Number" || node->kind == "Var") {
-        return node->value;
-    }
-
-    // Binary arithmetic or relational operations
-    if (node->kind == "BinaryOp" || node->kind == "RelOp") {
-        string left = genExpr(node->children[0]);
-        string right = genExpr(node->children[1]);
-        string tmp = newTemp();
-        code.push_back(tmp + " = " + left + " " + node->value + " " + right);
-        return tmp;
-    }
-
-    // Fallback: if node has children, recurse on first child
-    if (!node->children.empty()) {
-        return genExpr(node->children[0]);
-    }
-
-    return "";
-}
-
-void ICGGenerator::genStmt(const shared_ptr<ASTNode> &node) {
-    if (!node) return;
-
-    if (node->kind == "Program") {
-        if (!node->children.empty()) genStmt(node->children[0]);
-    }
-    else if (node->kind == "Function") {
-        if (!node->children.empty()) genStmt(node->children[0]);
-    }
-    else if (node->kind == "Block") {
-        for (auto &c : node->children) genStmt(c);
-    }
-    else if (node->kind == "Decl") {
-        // declaration with optional initializer
-        if (node->children.size() > 1) {
-            string rhs = genExpr(node->children[1]);
-            string lhs = node->value; // variable name
-            code.push_back(lhs + " = " + rhs);
-        }
-    }
-    else if (node->kind == "Assign") {
-        string op = node->value;
-        string lhs = node->children[0]->value;
-
-        if (op == "=") {
-            string rhs = genExpr(node->children[1]);
-            code.push_back(lhs + " = " + rhs);
-        }
-        else {
-            // compound assignment e.g. +=
-            string baseOp;
-            if (op == "+=") baseOp = "+";
-            else if (op == "-=") baseOp = "-";
-            else if (op == "*=") baseOp = "*";
-            else if (op == "/=") baseOp = "/";
-            else baseOp = "";
-
-            if (!baseOp.empty()) {
-                string right = genExpr(node->children[1]);
-                string tmp = newTemp();
-                code.push_back(tmp + " = " + lhs + " " + baseOp + " " + right);
-                code.push_back(lhs + " = " + tmp);
-            } else {
-                string rhs = genExpr(node->children[1]);
-                code.push_back(lhs + " = " + rhs);
-            }
-        }
-    }
-    else if (node->kind == "If") {
-        // children: [cond, thenNode, (elseNode)?]
-        string condTmp = genExpr(node->children[0]);
-        string Ltrue = newLabel();
-        string Lfalse = newLabel();
-        string Lend = newLabel();
-
-        code.push_back("if " + condTmp + " goto " + Ltrue);
-        code.push_back("goto " + Lfalse);
-
-        code.push_back(Ltrue + ":");
-        genStmt(node->children[1]);
-        code.push_back("goto " + Lend);
-
-        code.push_back(Lfalse + ":");
-        if (node->children.size() > 2) {
-            genStmt(node->children[2]); // else block
-        }
-        code.push_back(Lend + ":");
-    }
-    else if (node->kind == "Return") {
-        string val = genExpr(node->children[0]);
-        code.push_back("return " + val);
-    }
-    else {
-        // recurse by default
-        for (auto &c : node->children) genStmt(c);
-    }
-}
-
-void ICGGenerator::generate(const shared_ptr<ASTNode> &root) {
-    // reset internal state and generate
-    reset();
-    genStmt(root);
-}
-
-const vector<string>& ICGGenerator::getCode() const {
-    return code;
-}
+#include "icg.h"
+
+using namespace std;
+
+ICGGenerator::ICGGenerator() {
+    tempCount = 0;
+    labelCount = 0;
+    code.clear();
+}
+
+void ICGGenerator::reset() {
+    tempCount = 0;
+    labelCount = 0;
+    code.clear();
+}
+
+Operand ICGGenerator::newTemp(bool floating) {
+    return Operand::temp(++tempCount, floating);
+}
+
+Operand ICGGenerator::variable(NodeId node) const {
+    return Operand::var(ast->binding(node), ast->type(node) == ValueType::Float);
+}
+
+Operand ICGGenerator::newLabel() {
+    return Operand::label(++labelCount);
+}
+
+// Both generators walk the tree with an explicit stack of
+// (node, next child) frames instead of recursing, so nesting depth is not
+// limited by the native stack.
+struct GenFrame {
+    NodeId node;
+    uint32_t next;     // next child to visit (If: stage)
+    int label;         // If: number of its first label
+};
+
+Operand ICGGenerator::genExpr(NodeId root) {
+    const AST &t = *ast;
+    vector<GenFrame> stack;
+    vector<Operand> vals;          // operands produced by finished subtrees
+
+    stack.push_back({root, 0, 0});
+    while (!stack.empty()) {
+        GenFrame &f = stack.back();
+        NodeId node = f.node;
+        if (node == NO_NODE) {
+            stack.pop_back();
+            vals.push_back(Operand());
+            continue;
+        }
+
+        // Number literal (its decoded value) or variable
+        NodeKind kind = t.kind(node);
+        if (kind == NodeKind::Number) {
+            stack.pop_back();
+            vals.push_back(Operand::constant(t.number(node)));
+            continue;
+        }
+        if (kind == NodeKind::Var) {
+            stack.pop_back();
+            vals.push_back(variable(node));
+            continue;
+        }
+
+        // Binary operations need both operands; anything else falls back
+        // to its first child (if it has one)
+        bool binary = (kind == NodeKind::BinaryOp || kind == NodeKind::RelOp);
+        uint32_t arity = binary ? 2 : (t.numChildren(node) > 0 ? 1 : 0);
+        if (f.next < arity) {
+            NodeId c = t.child(node, f.next++);
+            stack.push_back({c, 0, 0});
+            continue;
+        }
+        stack.pop_back();
+
+        if (binary) {
+            // Binary arithmetic or relational operations
+            Operand right = vals.back(); vals.pop_back();
+            Operand left = vals.back(); vals.pop_back();
+            Quad q{binaryOpcode((TokenId)t.symbol(node)), {}, left, right};
+            q.dst = newTemp(resultIsDouble(q));
+            code.push_back(q);
+            vals.push_back(q.dst);
+        } else if (arity == 0) {
+            vals.push_back(Operand());
+        }
+    }
+    return vals.back();
+}
+
+// Statements without nested statements: Decl, Assign, Return
+void ICGGenerator::genSimpleStmt(NodeId node) {
+    const AST &t = *ast;
+    NodeKind kind = t.kind(node);
+
+    // Stores convert to the variable's declared type (see tac.h)
+    if (kind == NodeKind::Decl) {
+        // declaration with optional initializer
+        if (t.numChildren(node) > 1) {
+            Operand rhs = genExpr(t.child(node, 1));
+            code.push_back({Opcode::Copy, variable(node), rhs, {}});
+        }
+    }
+    else if (kind == NodeKind::Assign) {
+        TokenId op = (TokenId)t.symbol(node);
+        Operand lhs = variable(t.child(node, 0));
+
+        if (op == TokenId::PlusAssign || op == TokenId::MinusAssign ||
+            op == TokenId::StarAssign || op == TokenId::SlashAssign) {
+            // compound assignment e.g. +=
+            Operand right = genExpr(t.child(node, 1));
+            Quad q{binaryOpcode(op), {}, lhs, right};
+            q.dst = newTemp(resultIsDouble(q));
+            code.push_back(q);
+            code.push_back({Opcode::Copy, lhs, q.dst, {}});
+        } else {
+            Operand rhs = genExpr(t.child(node, 1));
+            code.push_back({Opcode::Copy, lhs, rhs, {}});
+        }
+    }
+    else if (kind == NodeKind::Return) {
+        Operand val = genExpr(t.child(node, 0));
+        code.push_back({Opcode::Return, {}, val, {}});
+    }
+}
+
+void ICGGenerator::genStmt(NodeId root) {
+    const AST &t = *ast;
+    vector<GenFrame> stack;
+
+    stack.push_back({root, 0, 0});
+    while (!stack.empty()) {
+        GenFrame &f = stack.back();
+        NodeId node = f.node;
+        if (node == NO_NODE) {
+            stack.pop_back();
+            continue;
+        }
+
+        NodeKind kind = t.kind(node);
+        size_t n = t.numChildren(node);
+
+        if (kind == NodeKind::If) {
+            // children: [cond, thenNode, (elseNode)?]
+            if (f.next == 0) {
+                Operand condTmp = genExpr(t.child(node, 0));
+                Operand Ltrue = newLabel();
+                Operand Lfalse = newLabel();
+                newLabel(); // Lend
+                f.label = labelCount - 2;
+                f.next = 1;
+
+                code.push_back({Opcode::IfGoto, {}, condTmp, Ltrue});
+                code.push_back({Opcode::Goto, {}, Lfalse, {}});
+                code.push_back({Opcode::Label, {}, Ltrue, {}});
+                stack.push_back({t.child(node, 1), 0, 0});
+            } else if (f.next == 1) {
+                code.push_back({Opcode::Goto, {}, Operand::label(f.label + 2), {}});
+                code.push_back({Opcode::Label, {}, Operand::label(f.label + 1), {}});
+                f.next = 2;
+                if (n > 2) stack.push_back({t.child(node, 2), 0, 0}); // else block
+            } else {
+                code.push_back({Opcode::Label, {}, Operand::label(f.label + 2), {}});
+                stack.pop_back();
+            }
+            continue;
+        }
+
+        if (kind == NodeKind::Decl || kind == NodeKind::Assign || kind == NodeKind::Return) {
+            stack.pop_back();
+            genSimpleStmt(node);
+            continue;
+        }
+
+        // Program / Function: the single child; Block (and anything else): all children
+        size_t limit = (kind == NodeKind::Program || kind == NodeKind::Function) ? min(n, (size_t)1) : n;
+        if (f.next < limit) {
+            NodeId c = t.child(node, f.next++);
+            stack.push_back({c, 0, 0});
+        } else {
+            stack.pop_back();
+        }
+    }
+}
+
+void ICGGenerator::generate(const AST &tree) {
+    // reset internal state and generate
+    reset();
+    ast = &tree;
+    genStmt(tree.root);
+}
+
+void ICGGenerator::generate(const AST &tree, NodeId stmt) {
+    reset();
+    ast = &tree;
+    genStmt(stmt);
+}
+
+const vector<Quad>& ICGGenerator::getCode() const {
+    return code;
+}
@@ -1,33 +1,38 @@
-#ifndef ICG_H
-#define ICG_H
-
-#include <iostream>
-#include <string>
-#include <vector>
-#include <memory>
-#include "parser.h"
-
-class ICGGenerator {
-private:
-    int tempCount = 0;
-    int labelCount = 0;
-    std::vector<std::string> code;
-
-    std::string newTemp();
-    std::string newLabel();
-    std::string genExpr(const std::shared_ptr<ASTNode> &node);
-    void genStmt(const std::shared_ptr<ASTNode> &node);
-
-public:
-    ICGGenerator();
-    // generate into internal vector (no printing)
-    void generate(const std::shared_ptr<ASTNode> &root);
-
-    // retrieve generated code (by reference) for optimization / printing
-    const std::vector<std::string>& getCode() const;
-
-    // convenience: clear/reset before generating
-    void reset();
-};
-
-#endif // ICG_H
+#ifndef ICG_H
+#define ICG_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "parser.h"
+#include "tac.h"
+
+class ICGGenerator {
+private:
+    int tempCount = 0;
+    int labelCount = 0;
+    std::vector<Quad> code;
+    const AST *ast = nullptr;
+
+    Operand newTemp(bool floating);
+    Operand variable(NodeId node) const;   // Var / Decl node: its TAC variable, typed
+    Operand newLabel();
+    Operand genExpr(NodeId node);
+    void genSimpleStmt(NodeId node);
+    void genStmt(NodeId node);
+
+public:
+    ICGGenerator();
+    // generate into internal vector (no printing)
+    void generate(const AST &tree);
+    // one statement alone, numbering its temps and labels from 1 (--watch)
+    void generate(const AST &tree, NodeId stmt);
+
+    // retrieve generated code (by reference) for optimization / printing
+    const std::vector<Quad>& getCode() const;
+
+    // convenience: clear/reset before generating
+    void reset();
+};
+
+#endif // ICG_H
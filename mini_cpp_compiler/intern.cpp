@@ -0,0 +1,76 @@
+#include "intern.h"
+#include <cstring>
+
+using namespace std;
+
+// FNV-1a, 32-bit
+static uint32_t hashBytes(string_view s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+StringInterner::StringInterner() {
+    clear();
+}
+
+void StringInterner::clear() {
+    entries.clear();
+    blocks.clear();
+    blockUsed = BLOCK_SIZE;
+    slots.assign(64, 0);
+    entries.push_back({"", 0, hashBytes("")});
+}
+
+const char *StringInterner::store(string_view s) {
+    if (s.size() > BLOCK_SIZE / 4) {
+        // large strings get a block of their own
+        blocks.emplace_back(new char[s.size()]);
+        char *p = blocks.back().get();
+        memcpy(p, s.data(), s.size());
+        if (blocks.size() > 1) swap(blocks.back(), blocks[blocks.size() - 2]);
+        return p;
+    }
+    if (blockUsed + s.size() > BLOCK_SIZE) {
+        blocks.emplace_back(new char[BLOCK_SIZE]);
+        blockUsed = 0;
+    }
+    char *p = blocks.back().get() + blockUsed;
+    memcpy(p, s.data(), s.size());
+    blockUsed += s.size();
+    return p;
+}
+
+void StringInterner::grow() {
+    vector<uint32_t> bigger(slots.size() * 2, 0);
+    size_t mask = bigger.size() - 1;
+    for (uint32_t id = 1; id < entries.size(); ++id) {
+        size_t i = entries[id].hash & mask;
+        while (bigger[i]) i = (i + 1) & mask;
+        bigger[i] = id + 1;
+    }
+    slots.swap(bigger);
+}
+
+uint32_t StringInterner::intern(string_view s) {
+    if (s.empty()) return EMPTY;
+
+    uint32_t h = hashBytes(s);
+    size_t mask = slots.size() - 1;
+    size_t i = h & mask;
+    while (uint32_t slot = slots[i]) {
+        const Entry &e = entries[slot - 1];
+        if (e.hash == h && e.length == s.size() && memcmp(e.chars, s.data(), s.size()) == 0)
+            return slot - 1;
+        i = (i + 1) & mask;
+    }
+
+    uint32_t id = (uint32_t)entries.size();
+    entries.push_back({store(s), (uint32_t)s.size(), h});
+    slots[i] = id + 1;
+    if (entries.size() * 2 > slots.size()) grow();
+    return id;
+}
@@ -0,0 +1,50 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// String interner: maps each distinct string to a dense 32-bit id.
+// - Id 0 is always the empty string.
+// - Characters live in fixed blocks that never move, so the views returned
+//   by str() stay valid for the interner's lifetime.
+// - Lookup is an open-addressing table of ids (no per-string allocation).
+class StringInterner {
+public:
+    static constexpr uint32_t EMPTY = 0;
+
+    StringInterner();
+    StringInterner(const StringInterner &) = delete;
+    StringInterner &operator=(const StringInterner &) = delete;
+
+    uint32_t intern(std::string_view s);
+    std::string_view str(uint32_t id) const {
+        const Entry &e = entries[id];
+        return std::string_view(e.chars, e.length);
+    }
+    size_t size() const { return entries.size(); }
+
+    // Drop every string at once (ids are reused from 1 afterwards)
+    void clear();
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Entry {
+        const char *chars;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    std::vector<Entry> entries;                    // id -> string
+    std::vector<uint32_t> slots;                   // hash table of id + 1 (0 = free)
+    std::vector<std::unique_ptr<char[]>> blocks;   // character storage
+    size_t blockUsed = BLOCK_SIZE;                 // bytes used in blocks.back()
+
+    const char *store(std::string_view s);
+    void grow();
+};
+
+#endif // INTERN_H
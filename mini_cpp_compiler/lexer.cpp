@@ -1,156 +1,632 @@
-#include "lexer.h"
-#include <unordered_set>
-#include <iostream>
-#include <cctype>
-
-using namespace std;
-
-// -----------------------------
-// Keyword and Symbol Definitions
-// -----------------------------
-static unordered_set<string> keywords = {
-    "int", "float", "if", "else", "while", "return", "for", "main"
-};
-
-static unordered_set<char> symbols = {
-    ';', ',', '{', '}', '(', ')'
-};
-
-// -----------------------------
-// Constructor
-// -----------------------------
-Lexer::Lexer(const string &input) : code(input), pos(0) {}
-
-// -----------------------------
-// Utility Functions
-// -----------------------------
-void Lexer::skipWhitespace() {
-    while (pos < code.size() && isspace((unsigned char)code[pos])) pos++;
-}
-
-void Lexer::skipComments() {
-    if (code[pos] == '/' && pos + 1 < code.size()) {
-        if (code[pos + 1] == '/') {
-            pos += 2;
-            while (pos < code.size() && code[pos] != '\n') pos++;
-        } else if (code[pos + 1] == '*') {
-            pos += 2;
-            while (pos + 1 < code.size() &&
-                   !(code[pos] == '*' && code[pos + 1] == '/')) pos++;
-            if (pos + 1 < code.size()) pos += 2;
-        }
-    }
-}
-
-string Lexer::readIdentifier() {
-    string result;
-    while (pos < code.size() &&
-           (isalnum((unsigned char)code[pos]) || code[pos] == '_'))
-        result += code[pos++];
-    return result;
-}
-
-string Lexer::readNumber() {
-    string result;
-    while (pos < code.size() &&
-           (isdigit((unsigned char)code[pos]) || code[pos] == '.'))
-        result += code[pos++];
-    return result;
-}
-
-string Lexer::readOperator() {
-    string op;
-    op += code[pos++];
-    if (pos < code.size()) {
-        char next = code[pos];
-        string two = op + next;
-        if (two == "==" || two == "!=" ||
-            two == "<=" || two == ">=" ||
-            two == "+=" || two == "-=" ||
-            two == "*=" || two == "/=") {
-            op = two;
-            pos++;
-        }
-    }
-    return op;
-}
-
-string Lexer::readString() {
-    string result;
-    pos++; // Skip initial quote
-    while (pos < code.size() && code[pos] != '"') {
-        if (code[pos] == '\\' && pos + 1 < code.size()) {
-            result += code[pos++]; // Keep escape
-        }
-        result += code[pos++];
-    }
-    if (pos < code.size() && code[pos] == '"') pos++;
-    return result;
-}
-
-// -----------------------------
-// Tokenization (Core Function)
-// -----------------------------
-vector<Token> Lexer::tokenize() {
-    tokens.clear();
-    pos = 0;
-
-    while (pos < code.size()) {
-        skipWhitespace();
-        if (pos >= code.size()) break;
-
-        // Skip comments first
-        if (code[pos] == '/' && pos + 1 < code.size() &&
-            (code[pos + 1] == '/' || code[pos + 1] == '*')) {
-            skipComments();
-            continue;
-        }
-
-        char current = code[pos];
-
-        if (isalpha((unsigned char)current) || current == '_') {
-            string word = readIdentifier();
-            if (keywords.count(word))
-                tokens.push_back({"KEYWORD", word});
-            else
-                tokens.push_back({"IDENTIFIER", word});
-        }
-        else if (isdigit((unsigned char)current)) {
-            tokens.push_back({"NUMBER", readNumber()});
-        }
-        else if (current == '"') {
-            tokens.push_back({"STRING", readString()});
-        }
-        else if (string("+-*/=<>!").find(current) != string::npos) {
-            tokens.push_back({"OPERATOR", readOperator()});
-        }
-        else if (symbols.count(current)) {
-            tokens.push_back({"SYMBOL", string(1, current)});
-            pos++;
-        }
-        else {
-            // -----------------------------
-            // UNKNOWN / INVALID CHARACTER
-            // -----------------------------
-            cout << "Lexical Error: Unknown symbol '" << current
-                 << "' at position " << pos << "\n";
-            tokens.push_back({"UNKNOWN", string(1, current)});
-            setErrorFlag(); // mark lexical error
-            pos++;
-        }
-    }
-
-    return tokens;
-}
-
-// -----------------------------
-// Token Printout
-// -----------------------------
-void Lexer::printTokens() {
-    cout << "===== LEXICAL ANALYSIS =====\n";
-    cout << "Type\t\tValue\n";
-    cout << "----------------------------\n";
-    for (auto &t : tokens) {
-        cout << t.type << "\t\t" << t.value << "\n";
-    }
-}
+#include "lexer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+// The whole token grammar is a DFA over byte classes whose tables are
+// computed at compile time; keywords are recognized with a constexpr
+// perfect hash. tokenize() is a single loop that looks up
+// transitions[state][charClass[byte]].
+
+// -----------------------------
+// Byte Classes
+// -----------------------------
+enum CharClass : uint8_t {
+    CC_OTHER, CC_SPACE, CC_NEWLINE, CC_ALPHA, CC_DIGIT, CC_DOT, CC_QUOTE,
+    CC_BACKSLASH, CC_SLASH, CC_STAR, CC_EQUAL, CC_OP, CC_SYMBOL,
+    NUM_CLASSES
+};
+
+static constexpr array<uint8_t, 256> buildCharClass() {
+    array<uint8_t, 256> cls{};
+    for (int c = 'a'; c <= 'z'; ++c) cls[c] = CC_ALPHA;
+    for (int c = 'A'; c <= 'Z'; ++c) cls[c] = CC_ALPHA;
+    for (int c = '0'; c <= '9'; ++c) cls[c] = CC_DIGIT;
+    cls['_'] = CC_ALPHA;
+    cls[' '] = cls['\t'] = cls['\v'] = cls['\f'] = cls['\r'] = CC_SPACE;
+    cls['\n'] = CC_NEWLINE;
+    cls['.'] = CC_DOT;
+    cls['"'] = CC_QUOTE;
+    cls['\\'] = CC_BACKSLASH;
+    cls['/'] = CC_SLASH;
+    cls['*'] = CC_STAR;
+    cls['='] = CC_EQUAL;
+    cls['+'] = cls['-'] = cls['<'] = cls['>'] = cls['!'] = CC_OP;
+    cls[';'] = cls[','] = cls['{'] = cls['}'] = cls['('] = cls[')'] = CC_SYMBOL;
+    return cls;
+}
+
+static constexpr array<uint8_t, 256> charClass = buildCharClass();
+
+// Operator / symbol id of a single byte (None if it is neither)
+static constexpr array<TokenId, 256> buildCharId() {
+    array<TokenId, 256> id{};
+    id['+'] = TokenId::Plus;    id['-'] = TokenId::Minus;
+    id['*'] = TokenId::Star;    id['/'] = TokenId::Slash;
+    id['='] = TokenId::Assign;  id['<'] = TokenId::Less;
+    id['>'] = TokenId::Greater; id['!'] = TokenId::Not;
+    id[';'] = TokenId::Semi;    id[','] = TokenId::Comma;
+    id['{'] = TokenId::LBrace;  id['}'] = TokenId::RBrace;
+    id['('] = TokenId::LParen;  id[')'] = TokenId::RParen;
+    return id;
+}
+
+static constexpr array<TokenId, 256> charId = buildCharId();
+
+// Operator followed by '=' ("==", "<=", "+=", ...)
+static constexpr TokenId withAssign(TokenId op) {
+    switch (op) {
+        case TokenId::Assign:  return TokenId::EqEq;
+        case TokenId::Not:     return TokenId::NotEq;
+        case TokenId::Less:    return TokenId::LessEq;
+        case TokenId::Greater: return TokenId::GreaterEq;
+        case TokenId::Plus:    return TokenId::PlusAssign;
+        case TokenId::Minus:   return TokenId::MinusAssign;
+        case TokenId::Star:    return TokenId::StarAssign;
+        case TokenId::Slash:   return TokenId::SlashAssign;
+        default:               return TokenId::None;
+    }
+}
+
+// -----------------------------
+// DFA
+// -----------------------------
+enum State : uint8_t {
+    ST_START,           // between tokens (whitespace loops here)
+    ST_IDENT,
+    ST_NUMBER,
+    ST_OP,              // one-char operator, may still take '='
+    ST_SLASH,           // '/', "/=", or the start of a comment
+    ST_LINE_COMMENT,
+    ST_BLOCK_COMMENT,
+    ST_BLOCK_STAR,      // '*' inside a block comment
+    ST_STRING,
+    ST_STRING_ESC,      // byte after '\' inside a string
+    NUM_STATES
+};
+
+// Actions that are not a plain move to another state
+enum Action : uint8_t {
+    EMIT = NUM_STATES,  // token ends before this byte (byte is not consumed)
+    EMIT_WITH,          // this byte completes the token
+    COMMENT_END         // this byte closes a block comment
+};
+
+using TransitionTable = array<array<uint8_t, NUM_CLASSES>, NUM_STATES>;
+
+static constexpr TransitionTable buildTransitions() {
+    TransitionTable t{};
+    for (auto &row : t)
+        for (auto &a : row) a = EMIT;
+
+    auto &start = t[ST_START];
+    for (auto &a : start) a = EMIT_WITH;            // symbols and unknown bytes
+    start[CC_SPACE] = start[CC_NEWLINE] = ST_START;
+    start[CC_ALPHA] = ST_IDENT;
+    start[CC_DIGIT] = ST_NUMBER;
+    start[CC_QUOTE] = ST_STRING;
+    start[CC_SLASH] = ST_SLASH;
+    start[CC_STAR] = start[CC_EQUAL] = start[CC_OP] = ST_OP;
+
+    t[ST_IDENT][CC_ALPHA] = t[ST_IDENT][CC_DIGIT] = ST_IDENT;
+    t[ST_NUMBER][CC_DIGIT] = t[ST_NUMBER][CC_DOT] = ST_NUMBER;
+
+    t[ST_OP][CC_EQUAL] = EMIT_WITH;
+    t[ST_SLASH][CC_EQUAL] = EMIT_WITH;
+    t[ST_SLASH][CC_SLASH] = ST_LINE_COMMENT;
+    t[ST_SLASH][CC_STAR] = ST_BLOCK_COMMENT;
+
+    for (auto &a : t[ST_LINE_COMMENT]) a = ST_LINE_COMMENT;
+    t[ST_LINE_COMMENT][CC_NEWLINE] = ST_START;
+
+    for (auto &a : t[ST_BLOCK_COMMENT]) a = ST_BLOCK_COMMENT;
+    t[ST_BLOCK_COMMENT][CC_STAR] = ST_BLOCK_STAR;
+    for (auto &a : t[ST_BLOCK_STAR]) a = ST_BLOCK_COMMENT;
+    t[ST_BLOCK_STAR][CC_STAR] = ST_BLOCK_STAR;
+    t[ST_BLOCK_STAR][CC_SLASH] = COMMENT_END;
+
+    for (auto &a : t[ST_STRING]) a = ST_STRING;
+    t[ST_STRING][CC_BACKSLASH] = ST_STRING_ESC;
+    t[ST_STRING][CC_QUOTE] = EMIT_WITH;
+    for (auto &a : t[ST_STRING_ESC]) a = ST_STRING;
+    return t;
+}
+
+static constexpr TransitionTable transitions = buildTransitions();
+
+static constexpr bool isCommentState(uint8_t s) {
+    return s == ST_LINE_COMMENT || s == ST_BLOCK_COMMENT || s == ST_BLOCK_STAR;
+}
+
+// -----------------------------
+// Keywords (constexpr perfect hash)
+// -----------------------------
+struct KeywordEntry {
+    const char *word;
+    uint8_t len;
+    TokenId id;
+};
+
+static constexpr KeywordEntry keywordList[] = {
+    {"int", 3, TokenId::KwInt},       {"float", 5, TokenId::KwFloat},
+    {"if", 2, TokenId::KwIf},         {"else", 4, TokenId::KwElse},
+    {"while", 5, TokenId::KwWhile},   {"return", 6, TokenId::KwReturn},
+    {"for", 3, TokenId::KwFor},       {"main", 4, TokenId::KwMain}
+};
+
+// Collision-free for the keyword set above (checked at compile time)
+static constexpr unsigned keywordHash(const char *p, size_t n) {
+    return (unsigned)(n * 5 + (unsigned char)p[0] + ((unsigned char)p[n - 1] << 1)) & 15;
+}
+
+using KeywordTable = array<KeywordEntry, 16>;
+
+static constexpr KeywordTable buildKeywordTable() {
+    KeywordTable table{};
+    for (auto &k : keywordList) {
+        auto &slot = table[keywordHash(k.word, k.len)];
+        if (slot.len != 0) throw "keyword hash collision";  // not a constant expression
+        slot = k;
+    }
+    return table;
+}
+
+static constexpr KeywordTable keywordTable = buildKeywordTable();
+
+static inline TokenId lookupKeyword(const char *p, size_t n) {
+    if (n < 2 || n > 6) return TokenId::None;
+    const KeywordEntry &k = keywordTable[keywordHash(p, n)];
+    if (k.len == n && memcmp(k.word, p, n) == 0) return k.id;
+    return TokenId::None;
+}
+
+const char *tokenKindName(TokenKind kind) {
+    switch (kind) {
+        case TokenKind::Keyword:    return "KEYWORD";
+        case TokenKind::Identifier: return "IDENTIFIER";
+        case TokenKind::Number:     return "NUMBER";
+        case TokenKind::String:     return "STRING";
+        case TokenKind::Operator:   return "OPERATOR";
+        case TokenKind::Symbol:     return "SYMBOL";
+        case TokenKind::Unknown:    return "UNKNOWN";
+        case TokenKind::Eof:        return "EOF";
+    }
+    return "UNKNOWN";
+}
+
+const char *tokenIdSpelling(TokenId id) {
+    switch (id) {
+        case TokenId::None:        return "";
+        case TokenId::KwInt:       return "int";
+        case TokenId::KwFloat:     return "float";
+        case TokenId::KwIf:        return "if";
+        case TokenId::KwElse:      return "else";
+        case TokenId::KwWhile:     return "while";
+        case TokenId::KwReturn:    return "return";
+        case TokenId::KwFor:       return "for";
+        case TokenId::KwMain:      return "main";
+        case TokenId::Plus:        return "+";
+        case TokenId::Minus:       return "-";
+        case TokenId::Star:        return "*";
+        case TokenId::Slash:       return "/";
+        case TokenId::Assign:      return "=";
+        case TokenId::Less:        return "<";
+        case TokenId::Greater:     return ">";
+        case TokenId::Not:         return "!";
+        case TokenId::EqEq:        return "==";
+        case TokenId::NotEq:       return "!=";
+        case TokenId::LessEq:      return "<=";
+        case TokenId::GreaterEq:   return ">=";
+        case TokenId::PlusAssign:  return "+=";
+        case TokenId::MinusAssign: return "-=";
+        case TokenId::StarAssign:  return "*=";
+        case TokenId::SlashAssign: return "/=";
+        case TokenId::Semi:        return ";";
+        case TokenId::Comma:       return ",";
+        case TokenId::LBrace:      return "{";
+        case TokenId::RBrace:      return "}";
+        case TokenId::LParen:      return "(";
+        case TokenId::RParen:      return ")";
+    }
+    return "";
+}
+
+StringInterner &symbolNames() {
+    static StringInterner *table = [] {
+        auto *t = new StringInterner;
+        for (int id = 1; id <= (int)TokenId::RParen; ++id)
+            t->intern(tokenIdSpelling((TokenId)id));
+        return t;
+    }();
+    return *table;
+}
+
+// -----------------------------
+// Constructors
+// -----------------------------
+Lexer::Lexer(const string &input)
+    : code(input), src(code.data()), srcLen(code.size()), pos(0), scan(scanOps()) {}
+
+Lexer::Lexer(SourceInput &input) : pos(0), scan(scanOps()) {
+    if (input.isMapped()) {
+        src = input.data();
+        srcLen = input.size();
+    } else {
+        stream = &input;
+    }
+}
+
+Lexer::Lexer(string_view buffer, size_t from, string *errors)
+    : src(buffer.data()), srcLen(buffer.size()), pos(from), scan(scanOps()), errorLog(errors) {}
+
+Lexer::Lexer(const char *data, size_t from, size_t to, uint8_t state, string *errors,
+             StringInterner &localNames)
+    : src(data), srcLen(to), pos(from), scan(scanOps()), names(&localNames),
+      entryState(state), errorLog(errors) {}
+
+// -----------------------------
+// Streaming Window
+// -----------------------------
+// Make n bytes available at pos: drop everything before the current token
+// (or before pos between tokens) and read further chunks behind it.
+bool Lexer::refill(size_t n) {
+    if (streamDone) return false;
+
+    size_t keep = inToken ? tokStart : pos;
+    code.erase(0, keep);
+    base += keep;
+    pos -= keep;
+    if (inToken) tokStart -= keep;
+
+    while (code.size() < pos + n) {
+        size_t old = code.size();
+        code.resize(old + SourceInput::CHUNK_SIZE);
+        size_t got = stream->read(&code[old], SourceInput::CHUNK_SIZE);
+        code.resize(old + got);
+        if (got == 0) {
+            streamDone = true;
+            break;
+        }
+    }
+    src = code.data();
+    srcLen = code.size();
+    return pos + n <= srcLen;
+}
+
+void Lexer::beginToken() {
+    tokStart = pos;
+    inToken = true;
+}
+
+// Record the lexeme [from, to) of the current token
+void Lexer::endToken(Token &tok, size_t from, size_t to) {
+    inToken = false;
+    if (tok.id != TokenId::None) tok.sym = (SymbolId)tok.id;
+    tok.length = (uint32_t)(to - from);
+    if (!stream) {
+        tok.offset = (uint32_t)from;
+    } else if (tok.kind == TokenKind::Identifier) {
+        tok.offset = tok.sym;
+    } else if (tok.id == TokenId::None) {
+        // the window moves on, so literals are kept aside too (interned:
+        // their text never moves and repeats are stored once)
+        tok.offset = names->intern(string_view(src + from, tok.length));
+    }
+}
+
+// Decode the literal [p, p + n) (digits and dots) into tok. Integers must
+// fit in 64 bits and at most one '.' is allowed.
+bool Lexer::decodeNumber(Token &tok, const char *p, size_t n) {
+    const char *end = p + n;
+    const char *dot = (const char *)memchr(p, '.', n);
+    if (!dot) {
+        int64_t v = 0;
+        auto r = from_chars(p, end, v);
+        if (r.ec != errc() || r.ptr != end) return false;
+        tok.intValue = v;
+        return true;
+    }
+    if (memchr(dot + 1, '.', end - dot - 1)) return false;
+    // from_chars wants at least one digit after the '.' ("1." is 1.0)
+    const char *stop = (dot + 1 == end) ? dot : end;
+    double v = 0;
+    auto r = from_chars(p, stop, v);
+    if (r.ec != errc() || r.ptr != stop) return false;
+    tok.isFloat = true;
+    tok.floatValue = v;
+    return true;
+}
+
+// Lexical errors are printed as they are found; parallel workers collect
+// them in errorLog
+void Lexer::report(const string &msg) {
+    if (errorLog) *errorLog += msg;
+    else cout << msg;
+}
+
+// -----------------------------
+// Tokenization (Core Function)
+// -----------------------------
+// Emit the token that ends in `state`; `closed` means the current byte was
+// consumed as its last character (op + '=', closing quote, symbol, unknown).
+void Lexer::finishToken(Token &tok, uint8_t state, bool closed) {
+    tok = Token();
+    size_t from = tokStart, to = pos;
+
+    switch (state) {
+        case ST_IDENT:
+            tok.id = lookupKeyword(src + from, to - from);
+            if (tok.id != TokenId::None) {
+                tok.kind = TokenKind::Keyword;
+            } else {
+                tok.kind = TokenKind::Identifier;
+                tok.sym = names->intern(string_view(src + from, to - from));
+            }
+            break;
+        case ST_NUMBER:
+            tok.kind = TokenKind::Number;
+            if (!decodeNumber(tok, src + from, to - from)) {
+                report("Lexical Error: Malformed number '" + string(src + from, to - from) +
+                       "' at position " + to_string(base + from) + "\n");
+                tok.kind = TokenKind::Unknown;
+                setErrorFlag();
+            }
+            break;
+        case ST_OP:
+        case ST_SLASH:
+            tok.kind = TokenKind::Operator;
+            tok.id = charId[(unsigned char)src[from]];
+            if (closed) tok.id = withAssign(tok.id);
+            break;
+        case ST_STRING:
+        case ST_STRING_ESC:
+            // lexeme excludes the quotes, escapes are kept
+            tok.kind = TokenKind::String;
+            from++;
+            if (closed) to--;
+            break;
+        default: {
+            char c = src[from];
+            tok.id = charId[(unsigned char)c];
+            if (tok.id != TokenId::None) {
+                tok.kind = TokenKind::Symbol;
+            } else {
+                // -----------------------------
+                // UNKNOWN / INVALID CHARACTER
+                // -----------------------------
+                report("Lexical Error: Unknown symbol '" + string(1, c) +
+                       "' at position " + to_string(base + from) + "\n");
+                tok.kind = TokenKind::Unknown;
+                setErrorFlag(); // mark lexical error
+            }
+            break;
+        }
+    }
+    endToken(tok, from, to);
+}
+
+const vector<Token>& Lexer::tokenize() {
+    tokens.clear();
+    if (!stream) pos = 0;
+    Token tok;
+    while (next(tok)) tokens.push_back(tok);
+    return tokens;
+}
+
+// Lex the next token into tok; false at the end of input. Every call starts
+// between tokens, so the DFA state does not outlive a call.
+bool Lexer::next(Token &tok) {
+    uint8_t state = entryState;
+    entryState = ST_START;
+
+    for (;;) {
+        // Self-loops are skipped a whole run at a time by the vectorized
+        // scanners; the table then handles the byte that ends the run.
+        switch (state) {
+            case ST_START:        pos += scan.spaceRun(src + pos, srcLen - pos); break;
+            case ST_IDENT:        pos += scan.identRun(src + pos, srcLen - pos); break;
+            case ST_NUMBER:       pos += scan.digitRun(src + pos, srcLen - pos); break;
+            case ST_LINE_COMMENT: pos += scan.findNewline(src + pos, srcLen - pos); break;
+            case ST_BLOCK_COMMENT: {
+                size_t n = srcLen - pos;
+                size_t k = scan.findCommentEnd(src + pos, n);
+                // without a match keep the last byte: it may be the '*' of "*/"
+                pos += (k < n || n == 0) ? k : n - 1;
+                break;
+            }
+            default: break;
+        }
+        if (!avail(1)) break;
+
+        uint8_t cls = charClass[(unsigned char)src[pos]];
+        uint8_t next = transitions[state][cls];
+
+        if (next < NUM_STATES) {
+            if (state == ST_START && next != ST_START) beginToken();
+            else if (isCommentState(next)) inToken = false;  // "/" was not an operator
+            state = next;
+            pos++;
+        } else if (next == EMIT) {
+            finishToken(tok, state, false);
+            return true;
+        } else if (next == EMIT_WITH) {
+            if (state == ST_START) beginToken();
+            pos++;
+            finishToken(tok, state, true);
+            return true;
+        } else {  // COMMENT_END
+            pos++;
+            state = ST_START;
+        }
+    }
+
+    // End of input: flush a pending token (an unterminated comment is dropped)
+    if (state != ST_START && !isCommentState(state)) {
+        finishToken(tok, state, false);
+        return true;
+    }
+    return false;
+}
+
+// -----------------------------
+// Parallel Tokenization
+// -----------------------------
+// Run job(0) .. job(count - 1) on up to `threads` threads; each thread
+// takes the next unclaimed index until none are left.
+static void runJobs(size_t count, unsigned threads, const function<void(size_t)> &job) {
+    atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next++) < count;) job(i);
+    };
+    vector<thread> pool;
+    for (size_t t = 1; t < min<size_t>(threads, count); ++t) pool.emplace_back(worker);
+    worker();
+    for (auto &th : pool) th.join();
+}
+
+// Pre-pass: the state the DFA is in after [p, p + n) when it starts in
+// `state`, tracking only what can carry over a newline (block comments and
+// strings). Everything else is skipped up to the next '/' or '"'.
+static uint8_t skimState(const ScanOps &scan, const char *p, size_t n, uint8_t state) {
+    size_t i = 0;
+    while (i < n) {
+        if (state == ST_START) {
+            i += scan.findSlashOrQuote(p + i, n - i);
+            if (i == n) break;
+            if (p[i] == '"') {
+                state = ST_STRING;
+                i++;
+            } else {
+                char c = (i + 1 < n) ? p[i + 1] : '\0';
+                if (c == '/') state = ST_LINE_COMMENT;
+                else if (c == '*') state = ST_BLOCK_COMMENT;
+                i += (c == '/' || c == '*' || c == '=') ? 2 : 1;
+            }
+        } else if (state == ST_LINE_COMMENT) {
+            i += scan.findNewline(p + i, n - i);
+            if (i == n) break;
+            state = ST_START;
+            i++;
+        } else if (state == ST_BLOCK_COMMENT) {
+            size_t k = scan.findCommentEnd(p + i, n - i);
+            if (k == n - i) break;
+            state = ST_START;
+            i += k + 2;
+        } else {  // ST_STRING
+            while (i < n && p[i] != '"') i += (p[i] == '\\') ? 2 : 1;
+            if (i >= n) break;
+            state = ST_START;
+            i++;
+        }
+    }
+    return state;
+}
+
+const vector<Token>& Lexer::tokenizeParallel(unsigned threads, size_t minChunk) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    minChunk = max<size_t>(minChunk, 1);
+    if (stream || threads == 1 || srcLen / minChunk < 2) return tokenize();
+
+    // Cut just after a newline near every 1/k of the input. A token never
+    // spans a newline unless it is a string literal.
+    size_t want = min<size_t>(srcLen / minChunk, (size_t)threads * 4);
+    vector<size_t> cut{0};
+    for (size_t k = 1; k < want; ++k) {
+        size_t at = max(srcLen / want * k, cut.back());
+        at += scan.findNewline(src + at, srcLen - at);
+        if (at + 1 >= srcLen) break;
+        cut.push_back(at + 1);
+    }
+    cut.push_back(srcLen);
+    size_t n = cut.size() - 1;
+
+    // Find the state each chunk starts in: skim every chunk in parallel as
+    // if it started between tokens, then walk the results in order and skim
+    // again the (rare) chunks that really start inside a comment or string.
+    vector<uint8_t> exitState(n);
+    runJobs(n, threads, [&](size_t i) {
+        exitState[i] = skimState(scan, src + cut[i], cut[i + 1] - cut[i], ST_START);
+    });
+    vector<uint8_t> entry(n, ST_START);
+    for (size_t i = 1; i < n; ++i) {
+        entry[i] = exitState[i - 1];
+        if (entry[i] != ST_START)
+            exitState[i] = skimState(scan, src + cut[i], cut[i + 1] - cut[i], entry[i]);
+    }
+
+    // A chunk that starts inside a string joins the one before it, so
+    // every part starts between tokens or inside a block comment
+    struct Part {
+        size_t from, to;
+        uint8_t entry;
+        vector<Token> tokens;
+        unique_ptr<StringInterner> names{new StringInterner};   // merged afterwards
+        string errors;
+        bool hasError = false;
+        Part(size_t f, size_t t, uint8_t e) : from(f), to(t), entry(e) {}
+    };
+    vector<Part> parts;
+    for (size_t i = 0; i < n; ++i) {
+        if (entry[i] == ST_STRING) parts.back().to = cut[i + 1];
+        else parts.emplace_back(cut[i], cut[i + 1], entry[i]);
+    }
+
+    runJobs(parts.size(), threads, [&](size_t i) {
+        Part &part = parts[i];
+        Lexer sub(src, part.from, part.to, part.entry, &part.errors, *part.names);
+        Token tok;
+        while (sub.next(tok)) part.tokens.push_back(tok);
+        part.hasError = sub.hasError;
+    });
+
+    // Each worker numbered its names on its own: map them to the shared
+    // ids (one lookup per distinct name and part)
+    vector<vector<SymbolId>> remap(parts.size());
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const StringInterner &local = *parts[i].names;
+        remap[i].resize(local.size());
+        for (uint32_t id = 1; id < local.size(); ++id)
+            remap[i][id] = names->intern(local.str(id));
+    }
+
+    // Concatenate in input order; messages come out as the serial lexer
+    // would have printed them
+    vector<size_t> first(parts.size() + 1, 0);
+    for (size_t i = 0; i < parts.size(); ++i)
+        first[i + 1] = first[i] + parts[i].tokens.size();
+    tokens.clear();
+    tokens.resize(first.back());
+    runJobs(parts.size(), threads, [&](size_t i) {
+        Token *out = tokens.data() + first[i];
+        for (Token tok : parts[i].tokens) {
+            if (tok.kind == TokenKind::Identifier) tok.sym = remap[i][tok.sym];
+            *out++ = tok;
+        }
+    });
+    for (auto &part : parts) {
+        cout << part.errors;
+        if (part.hasError) setErrorFlag();
+    }
+    return tokens;
+}
+
+// -----------------------------
+// Token Printout
+// -----------------------------
+// Lists the tokens collected by tokenize()
+void Lexer::printTokens() const {
+    cout << "===== LEXICAL ANALYSIS =====\n";
+    cout << "Type\t\tValue\n";
+    cout << "----------------------------\n";
+    for (const Token &t : tokens) {
+        cout << tokenKindName(t.kind) << "\t\t" << text(t) << "\n";
+    }
+}
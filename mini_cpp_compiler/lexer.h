@@ -1,33 +1,124 @@
-#ifndef LEXER_H
-#define LEXER_H
-
-#include <iostream>
-#include <vector>
-#include <string>
-#include "token.h"
-using namespace std;
-
-class Lexer {
-private:
-    vector<Token> tokens;
-    string code;
-    size_t pos = 0;
-    bool hasError = false;
-
-    void skipWhitespace();
-    void skipComments();
-    string readIdentifier();
-    string readNumber();
-    string readOperator();
-    string readString();
-
-public:
-    Lexer(const string &input);
-    vector<Token> tokenize();
-    void printTokens();
-
-    bool hasErrors() const { return hasError; }
-    void setErrorFlag() { hasError = true; }
-};
-
-#endif
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include "token.h"
+#include "source.h"
+#include "scan.h"
+#include "intern.h"
+using namespace std;
+
+class Lexer {
+private:
+    vector<Token> tokens;
+    string code;                  // owned bytes: whole input, or the streaming window
+    const char *src = nullptr;    // bytes being scanned (code, or a mapped file)
+    size_t srcLen = 0;
+    size_t pos = 0;               // scan position inside src
+    size_t base = 0;              // absolute input offset of src[0]
+    bool hasError = false;
+    const ScanOps &scan;          // vectorized character-class scanners
+
+    // Names are interned here (the shared symbolNames(), or a parallel
+    // worker's own table). Streaming mode keeps the text of literals here
+    // too, since the window moves on (tokens hold their ids).
+    StringInterner *names = &symbolNames();
+
+    // Streaming mode: input is pulled in chunks
+    SourceInput *stream = nullptr;
+    size_t tokStart = 0;          // start of the token being read (inside src)
+    bool inToken = false;         // bytes from tokStart must survive a refill
+    bool streamDone = false;
+    uint8_t entryState = 0;       // DFA state for the next call to next()
+
+    // Parallel workers lex a slice of another lexer's buffer and collect
+    // their error messages here instead of printing them
+    string *errorLog = nullptr;
+
+    Lexer(const char *data, size_t from, size_t to, uint8_t state, string *errors,
+          StringInterner &localNames);
+
+    bool avail(size_t n) { return pos + n <= srcLen || (stream && refill(n)); }
+    bool refill(size_t n);
+    void beginToken();
+    void endToken(Token &tok, size_t from, size_t to);
+    void finishToken(Token &tok, uint8_t state, bool closed);
+    bool decodeNumber(Token &tok, const char *p, size_t n);
+    void report(const string &msg);
+
+public:
+    Lexer(const string &input);
+    Lexer(SourceInput &input);    // scans mapped bytes in place, or streams
+    // Lexes a buffer the caller keeps alive, starting at byte `from` (which
+    // must be between tokens); with `errors`, messages are appended there
+    // instead of printed
+    Lexer(string_view buffer, size_t from, string *errors = nullptr);
+
+    // Pull interface: the next token, false at the end of input
+    bool next(Token &tok);
+
+    // Whole-input interface: every token in one vector
+    const vector<Token>& tokenize();
+
+    // Same tokens and messages as tokenize(), with the input split at
+    // newlines and lexed on `threads` threads (0 = one per core). Streamed
+    // input and inputs under two chunks of `minChunk` bytes are lexed serially.
+    static constexpr size_t PARALLEL_MIN_CHUNK = 256 * 1024;
+    const vector<Token>& tokenizeParallel(unsigned threads = 0, size_t minChunk = PARALLEL_MIN_CHUNK);
+    void printTokens() const;     // lists the tokens of tokenize()
+    const vector<Token>& getTokens() const { return tokens; }
+
+    // Lexeme of a token produced by this lexer (a view, nothing is copied)
+    string_view text(const Token &tok) const {
+        if (tok.id != TokenId::None) return tokenIdSpelling(tok.id);
+        if (stream) return names->str(tok.offset);
+        return string_view(src + tok.offset, tok.length);
+    }
+
+    bool hasErrors() const { return hasError; }
+    void setErrorFlag() { hasError = true; }
+};
+
+// Pull-based token source for the parser: tokens are lexed on demand into
+// a small ring, so only the lookahead window is ever held in memory.
+class TokenCursor {
+public:
+    static constexpr size_t LOOKAHEAD = 4;    // ring size (power of two)
+
+    explicit TokenCursor(Lexer &lex) : lexer(&lex) {}
+    // Tokens lexed earlier: [first, last) of an existing array
+    TokenCursor(const Token *first, const Token *last) : array(first), arrayEnd(last) {}
+
+    // k-th token ahead (k < LOOKAHEAD), nullptr past the end of input
+    const Token *peek(size_t k = 0) {
+        if (!lexer) return (size_t)(arrayEnd - array) > k ? array + k : nullptr;
+        while (count <= k && !done) fill();
+        return k < count ? &ring[(head + k) & (LOOKAHEAD - 1)] : nullptr;
+    }
+    void advance() {
+        if (!lexer) {
+            if (array < arrayEnd) array++;
+            return;
+        }
+        if (!peek()) return;
+        head = (head + 1) & (LOOKAHEAD - 1);
+        count--;
+    }
+
+private:
+    Lexer *lexer = nullptr;
+    const Token *array = nullptr, *arrayEnd = nullptr;
+    Token ring[LOOKAHEAD];
+    size_t head = 0, count = 0;
+    bool done = false;
+
+    void fill() {
+        if (lexer->next(ring[(head + count) & (LOOKAHEAD - 1)])) count++;
+        else done = true;
+    }
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "machine.h"
+#include "intern.h"
+#include "lexer.h"
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+bool MOperand::operator==(const MOperand &o) const {
+    if (kind != o.kind) return false;
+    switch (kind) {
+        case MOperandKind::None:   return true;
+        case MOperandKind::RetReg: return true;
+        case MOperandKind::Imm:    return i == o.i;
+        case MOperandKind::FImm:   return memcmp(&f, &o.f, sizeof f) == 0;
+        default:                   return id == o.id;
+    }
+}
+
+// -----------------------------
+// Printing
+// -----------------------------
+string formatMOperand(const MOperand &o) {
+    switch (o.kind) {
+        case MOperandKind::None:       return "";
+        case MOperandKind::Reg:        return "r" + to_string(o.id);
+        case MOperandKind::RetReg:     return "ret";
+        case MOperandKind::Mem:        return string(symbolNames().str(o.id));
+        case MOperandKind::Slot:       return "[sp+" + to_string(8 * o.id) + "]";
+        case MOperandKind::Imm:        return formatOperand(Operand::integer(o.i));
+        case MOperandKind::FImm:       return formatOperand(Operand::real(o.f));
+        case MOperandKind::Label:      return formatOperand(Operand::label(o.id));
+        case MOperandKind::LocalLabel: return (o.id & 1 ? "__Lend" : "__Ltrue") + to_string(o.id >> 1);
+    }
+    return "";
+}
+
+static const char *mnemonic(MOpcode op) {
+    switch (op) {
+        case MOpcode::Mov: return "MOV";
+        case MOpcode::Add: return "ADD";
+        case MOpcode::Sub: return "SUB";
+        case MOpcode::Mul: return "MUL";
+        case MOpcode::Div: return "DIV";
+        case MOpcode::Cmp: return "CMP";
+        case MOpcode::Jmp: return "JMP";
+        case MOpcode::Jl:  return "JL";
+        case MOpcode::Jle: return "JLE";
+        case MOpcode::Jg:  return "JG";
+        case MOpcode::Jge: return "JGE";
+        case MOpcode::Je:  return "JE";
+        case MOpcode::Jne: return "JNE";
+        case MOpcode::Label: return "";
+        case MOpcode::Ret: return "RETURN";
+    }
+    return "";
+}
+
+string formatMachineInstr(const MachineInstr &mi) {
+    if (mi.op == MOpcode::Label) return formatMOperand(mi.a) + ":";
+    string text = mnemonic(mi.op);
+    if (mi.a.kind != MOperandKind::None) text += " " + formatMOperand(mi.a);
+    if (mi.b.kind != MOperandKind::None) text += ", " + formatMOperand(mi.b);
+    return text;
+}
+
+vector<string> formatAssembly(const MachineFunction &mf) {
+    vector<string> out;
+    string scratch0 = formatMOperand(MOperand::reg(mf.scratch[0]));
+    string scratch1 = formatMOperand(MOperand::reg(mf.scratch[1]));
+    out.push_back("; --- generated pseudo-assembly ---");
+    out.push_back("; Registers: r0-r" + to_string(mf.registers - 1) + " (" + scratch0 + ", " +
+                  scratch1 + " scratch)");
+    if (!mf.varRegs.empty()) out.push_back("; Variables (registers):");
+    for (auto &[name, reg] : mf.varRegs)
+        out.push_back("; " + string(symbolNames().str(name)) + " -> " + formatMOperand(MOperand::reg(reg)));
+    out.push_back("; Variables (memory):");
+    for (SymbolId name : mf.memoryVars) out.push_back("; var: " + string(symbolNames().str(name)));
+    if (mf.spillSlots) out.push_back("; Spill slots: " + to_string(mf.spillSlots));
+    out.push_back("");
+
+    for (const MachineInstr &mi : mf.code) out.push_back(formatMachineInstr(mi));
+
+    out.push_back("");
+    out.push_back("; --- end of generated assembly ---");
+    return out;
+}
+
+// -----------------------------
+// Peephole optimizer
+// -----------------------------
+namespace {
+
+const uint64_t RET_BIT = 1ull << 63;
+
+uint64_t regBit(const MOperand &o) {
+    if (o.kind == MOperandKind::Reg) return 1ull << o.id;
+    if (o.kind == MOperandKind::RetReg) return RET_BIT;
+    return 0;
+}
+
+bool writesA(MOpcode op) { return op >= MOpcode::Mov && op <= MOpcode::Div; }
+
+// A DIV by anything but a nonzero immediate may fault: it stays even
+// when its result is not read
+bool mayFault(const MachineInstr &mi) {
+    return mi.op == MOpcode::Div && !(mi.b.kind == MOperandKind::Imm && mi.b.i != 0);
+}
+
+uint64_t regsRead(const MachineInstr &mi) {
+    switch (mi.op) {
+        case MOpcode::Mov: return regBit(mi.b);
+        case MOpcode::Add: case MOpcode::Sub: case MOpcode::Mul: case MOpcode::Div:
+        case MOpcode::Cmp: return regBit(mi.a) | regBit(mi.b);
+        case MOpcode::Ret: return RET_BIT;
+        default: return 0;
+    }
+}
+
+uint64_t regsWritten(const MachineInstr &mi) { return writesA(mi.op) ? regBit(mi.a) : 0; }
+
+uint64_t labelKey(const MOperand &o) { return (uint64_t)o.kind << 32 | o.id; }
+
+MOpcode inverse(MOpcode op) {
+    switch (op) {
+        case MOpcode::Jl:  return MOpcode::Jge;
+        case MOpcode::Jge: return MOpcode::Jl;
+        case MOpcode::Jle: return MOpcode::Jg;
+        case MOpcode::Jg:  return MOpcode::Jle;
+        case MOpcode::Je:  return MOpcode::Jne;
+        default:           return MOpcode::Je;
+    }
+}
+
+class Peephole {
+public:
+    explicit Peephole(vector<MachineInstr> &c) : code(c) {}
+    bool round();       // one scan over the code; true if anything changed
+
+private:
+    vector<MachineInstr> &code;
+    vector<uint64_t> liveOut;                 // registers read later, per instruction
+    unordered_map<uint64_t, size_t> labelAt;  // label -> position
+    vector<uint32_t> jumpsTo;                 // per position of a label: jumps naming it
+    vector<char> dead, touched;
+
+    void analyze();
+    bool free(size_t i, size_t count) const;
+    void touch(size_t i, size_t count) { for (size_t k = 0; k < count; ++k) touched[i + k] = 1; }
+    bool deadAfter(size_t i, const MOperand &r) const { return r.isReg() && !(liveOut[i] & regBit(r)); }
+    // next position after i that is not a label
+    size_t skipLabels(size_t i) const {
+        while (i < code.size() && code[i].op == MOpcode::Label) ++i;
+        return i;
+    }
+    bool tryAt(size_t i);
+};
+
+// Register liveness over the instruction list (jumps are followed), and
+// where each label is and how many jumps name it
+void Peephole::analyze() {
+    size_t n = code.size();
+    labelAt.clear();
+    for (size_t i = 0; i < n; ++i)
+        if (code[i].op == MOpcode::Label) labelAt[labelKey(code[i].a)] = i;
+    jumpsTo.assign(n, 0);
+    for (const MachineInstr &mi : code) {
+        if (!isJump(mi.op)) continue;
+        auto it = labelAt.find(labelKey(mi.a));
+        if (it != labelAt.end()) jumpsTo[it->second]++;
+    }
+
+    // past the last instruction (code with no RETURN at its end falls
+    // through into code not seen here) every register may be read
+    vector<uint64_t> liveIn(n + 1, 0);
+    liveIn[n] = ~0ull;
+    liveOut.assign(n, 0);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = n; i-- > 0;) {
+            const MachineInstr &mi = code[i];
+            uint64_t out = 0;
+            if (isJump(mi.op)) {
+                auto it = labelAt.find(labelKey(mi.a));
+                out |= (it == labelAt.end()) ? ~0ull : liveIn[it->second];
+            }
+            if (mi.op != MOpcode::Jmp && mi.op != MOpcode::Ret) out |= liveIn[i + 1];
+            uint64_t in = regsRead(mi) | (out & ~regsWritten(mi));
+            if (out != liveOut[i] || in != liveIn[i]) {
+                liveOut[i] = out;
+                liveIn[i] = in;
+                changed = true;
+            }
+        }
+    }
+}
+
+// Can instructions [i, i+count) still be rewritten in this round?
+bool Peephole::free(size_t i, size_t count) const {
+    if (i + count > code.size()) return false;
+    for (size_t k = 0; k < count; ++k)
+        if (touched[i + k]) return false;
+    return true;
+}
+
+bool Peephole::tryAt(size_t i) {
+    MachineInstr &mi = code[i];
+    size_t n = code.size();
+
+    // MOV x, x
+    if (mi.op == MOpcode::Mov && mi.a == mi.b && free(i, 1)) {
+        dead[i] = 1;
+        touch(i, 1);
+        return true;
+    }
+
+    // a register result no one reads
+    if (writesA(mi.op) && mi.a.isReg() && deadAfter(i, mi.a) && !mayFault(mi) && free(i, 1)) {
+        dead[i] = 1;
+        touch(i, 1);
+        return true;
+    }
+
+    // jump to a label that directly follows
+    if (isJump(mi.op) && free(i, 1)) {
+        auto it = labelAt.find(labelKey(mi.a));
+        if (it != labelAt.end() && it->second > i && skipLabels(i + 1) > it->second) {
+            dead[i] = 1;
+            touch(i, 1);
+            return true;
+        }
+    }
+
+    // CMP whose flags no jump reads
+    if (mi.op == MOpcode::Cmp && (i + 1 >= n || !isCondJump(code[i + 1].op)) && free(i, 1)) {
+        dead[i] = 1;
+        touch(i, 1);
+        return true;
+    }
+
+    // label no jump names
+    if (mi.op == MOpcode::Label && jumpsTo[i] == 0 && free(i, 1)) {
+        dead[i] = 1;
+        touch(i, 1);
+        return true;
+    }
+
+    if (i + 1 >= n) return false;
+    MachineInstr &next = code[i + 1];
+
+    // MOV x, y; MOV y, x: the second copy changes nothing
+    if (mi.op == MOpcode::Mov && next.op == MOpcode::Mov && next.a == mi.b && next.b == mi.a && free(i + 1, 1)) {
+        dead[i + 1] = 1;
+        touch(i + 1, 1);
+        return true;
+    }
+
+    // MOV s, X; OP s, Y; MOV D, s  ->  OP X, Y (D == X) or MOV D, X; OP D, Y
+    if (i + 2 < n && mi.op == MOpcode::Mov && mi.a.kind == MOperandKind::Reg &&
+        next.op >= MOpcode::Add && next.op <= MOpcode::Div && next.a == mi.a && next.b != mi.a &&
+        code[i + 2].op == MOpcode::Mov && code[i + 2].b == mi.a && code[i + 2].a != mi.a &&
+        deadAfter(i + 2, mi.a) && free(i, 3)) {
+        MOperand s = mi.a, X = mi.b, Y = next.b, D = code[i + 2].a;
+        if (D == X && !(X.isMemory() && Y.isMemory()) && X.kind != MOperandKind::Imm &&
+            X.kind != MOperandKind::FImm) {
+            mi = MachineInstr{next.op, X, Y};
+            dead[i + 1] = dead[i + 2] = 1;
+            touch(i, 3);
+            return true;
+        }
+        if (D != X && D != Y && (D.isReg() || !Y.isMemory()) && regBit(D) != regBit(s)) {
+            mi = MachineInstr{MOpcode::Mov, D, X};
+            next = MachineInstr{next.op, D, Y};
+            dead[i + 2] = 1;
+            touch(i, 3);
+            return true;
+        }
+    }
+
+    // MOV r, X; I(..r..) with r dead after I  ->  I(..X..)
+    if (mi.op == MOpcode::Mov && mi.a.kind == MOperandKind::Reg && deadAfter(i + 1, mi.a) && free(i, 2)) {
+        const MOperand &r = mi.a, &X = mi.b;
+        MachineInstr merged = next;
+        bool ok = false;
+        if (next.op == MOpcode::Mov && next.b == r && next.a != r) {
+            merged.b = X;
+            ok = !(X.isMemory() && next.a.isMemory());
+        } else if (next.op >= MOpcode::Add && next.op <= MOpcode::Div && next.b == r && next.a != r) {
+            merged.b = X;
+            ok = !(X.isMemory() && next.a.isMemory());
+        } else if (next.op == MOpcode::Cmp && (next.a == r) != (next.b == r)) {
+            (next.a == r ? merged.a : merged.b) = X;
+            ok = !(merged.a.isMemory() && merged.b.isMemory()) &&
+                 merged.a.kind != MOperandKind::Imm && merged.a.kind != MOperandKind::FImm;
+        }
+        if (ok) {
+            next = merged;
+            dead[i] = 1;
+            touch(i, 2);
+            return true;
+        }
+    }
+
+    // CMP A, B; Jcc T; MOV w, 0; JMP E; T: MOV w, 1; E: CMP w, 0; JNE/JE X
+    //   ->  CMP A, B; Jcc X  (or the inverse jump for JE)
+    // (the inverse assumes ordered comparisons, as the integer CMP does)
+    if (mi.op == MOpcode::Cmp && i + 8 < n && isCondJump(next.op)) {
+        const MachineInstr *w = &code[i + 2];
+        MOperand reg = w->a;
+        bool match = w->op == MOpcode::Mov && reg.kind == MOperandKind::Reg && w->b == MOperand::imm(0) &&
+                     code[i + 3].op == MOpcode::Jmp && code[i + 4].op == MOpcode::Label &&
+                     code[i + 4].a == next.a && code[i + 5].op == MOpcode::Mov && code[i + 5].a == reg &&
+                     code[i + 5].b == MOperand::imm(1) && code[i + 6].op == MOpcode::Label &&
+                     code[i + 6].a == code[i + 3].a && code[i + 7].op == MOpcode::Cmp &&
+                     code[i + 7].a == reg && code[i + 7].b == MOperand::imm(0) &&
+                     (code[i + 8].op == MOpcode::Jne || code[i + 8].op == MOpcode::Je) &&
+                     jumpsTo[i + 4] == 1 && jumpsTo[i + 6] == 1 && deadAfter(i + 8, reg) && free(i, 9);
+        if (match) {
+            MOpcode jcc = code[i + 8].op == MOpcode::Jne ? next.op : inverse(next.op);
+            next = MachineInstr{jcc, code[i + 8].a, MOperand()};
+            for (size_t k = 2; k <= 8; ++k) dead[i + k] = 1;
+            touch(i, 9);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Peephole::round() {
+    analyze();
+    dead.assign(code.size(), 0);
+    touched.assign(code.size(), 0);
+    bool changed = false;
+    for (size_t i = 0; i < code.size(); ++i)
+        if (!touched[i]) changed |= tryAt(i);
+    if (!changed) return false;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < code.size(); ++i)
+        if (!dead[i]) code[kept++] = code[i];
+    code.resize(kept);
+    return true;
+}
+
+} // namespace
+
+void peephole(MachineFunction &mf) {
+    Peephole pass(mf.code);
+    while (pass.round()) {}
+}
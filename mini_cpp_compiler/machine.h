@@ -0,0 +1,96 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tac.h"
+
+// Target instructions produced by codegen. Each is "OP a, b" in the
+// two-address style of the pseudo-assembly (MOV/ADD/... write a); text
+// is produced only when the assembly is printed.
+
+enum class MOpcode : uint8_t {
+    Mov, Add, Sub, Mul, Div,          // a = b, a op= b
+    Cmp,                              // compare a with b
+    Jmp, Jl, Jle, Jg, Jge, Je, Jne,   // jump to a (conditional on the last Cmp)
+    Label,                            // a:
+    Ret                               // return the value in the ret register
+};
+
+enum class MOperandKind : uint8_t {
+    None,
+    Reg,          // rN
+    RetReg,       // ret
+    Mem,          // variable kept in memory (SymbolId)
+    Slot,         // stack slot of a spilled temp: [sp+8*N]
+    Imm,          // integer immediate
+    FImm,         // floating-point immediate
+    Label,        // TAC label LN
+    LocalLabel    // codegen's own labels: even id __LtrueN, odd id __LendN
+};
+
+struct MOperand {
+    MOperandKind kind = MOperandKind::None;
+    union {
+        uint32_t id = 0;
+        int64_t i;
+        double f;
+    };
+
+    static MOperand make(MOperandKind k, uint32_t n) { MOperand o; o.kind = k; o.id = n; return o; }
+    static MOperand reg(uint32_t n) { return make(MOperandKind::Reg, n); }
+    static MOperand ret() { return make(MOperandKind::RetReg, 0); }
+    static MOperand mem(SymbolId name) { return make(MOperandKind::Mem, name); }
+    static MOperand slot(uint32_t n) { return make(MOperandKind::Slot, n); }
+    static MOperand label(uint32_t n) { return make(MOperandKind::Label, n); }
+    static MOperand local(uint32_t n) { return make(MOperandKind::LocalLabel, n); }
+    static MOperand imm(int64_t v) { MOperand o; o.kind = MOperandKind::Imm; o.i = v; return o; }
+    static MOperand fimm(double v) { MOperand o; o.kind = MOperandKind::FImm; o.f = v; return o; }
+
+    bool isReg() const { return kind == MOperandKind::Reg || kind == MOperandKind::RetReg; }
+    bool isMemory() const { return kind == MOperandKind::Mem || kind == MOperandKind::Slot; }
+    bool isLabel() const { return kind == MOperandKind::Label || kind == MOperandKind::LocalLabel; }
+
+    bool operator==(const MOperand &o) const;
+    bool operator!=(const MOperand &o) const { return !(*this == o); }
+};
+
+struct MachineInstr {
+    MOpcode op;
+    MOperand a, b;
+};
+
+// Jmp or a conditional jump?
+inline bool isJump(MOpcode op) { return op >= MOpcode::Jmp && op <= MOpcode::Jne; }
+inline bool isCondJump(MOpcode op) { return op >= MOpcode::Jl && op <= MOpcode::Jne; }
+
+// Codegen's result: the instructions plus what the prologue comments show
+struct MachineFunction {
+    std::vector<MachineInstr> code;
+    int registers = 0;
+    int scratch[2] = {0, 0};
+    std::vector<std::pair<SymbolId, uint32_t>> varRegs;   // promoted variables
+    std::vector<SymbolId> memoryVars;                     // variables left in memory
+    size_t spillSlots = 0;
+};
+
+std::string formatMOperand(const MOperand &o);
+std::string formatMachineInstr(const MachineInstr &mi);   // "MOV r0, 5", "L2:"
+// Full listing: prologue comments, instructions, epilogue
+std::vector<std::string> formatAssembly(const MachineFunction &mf);
+
+// Pattern-driven peephole optimizer, run to a fixed point:
+// - MOV x, x and the second MOV of "MOV x, y; MOV y, x" are dropped
+// - writes to registers that are never read again are dropped (code
+//   that does not end in RETURN falls through into code not seen here,
+//   which may read any register)
+// - "MOV r, X; MOV Y, r" with r dead becomes "MOV Y, X", and
+//   "MOV s, X; OP s, Y; MOV X, s" with s dead becomes "OP X, Y"
+// - a 0/1 relational result that only feeds "CMP r, 0; JNE/JE" is fused
+//   into a single conditional jump
+// - jumps to the next instruction, CMPs no jump reads and labels no one
+//   jumps to are removed
+void peephole(MachineFunction &mf);
+
+#endif // MACHINE_H
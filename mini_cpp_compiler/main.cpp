@@ -1,102 +1,338 @@
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <string>
-
-#include "token.h"
-#include "lexer.h"
-#include "parser.h"
-#include "semantic.h"
-#include "icg.h"
-#include "opt.h"
-#include "codegen.h"
-
-using namespace std;
-
-int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        cerr << "Usage: mini_compiler <source_file>\n";
-        return 1;
-    }
-
-    string filename = argv[1];
-
-    cout << "=============================================\n";
-    cout << "        Mini C++ Compiler - Phase 1 to 6\n";
-    cout << "=============================================\n";
-    cout << "Compiling file: " << filename << "\n\n";
-
-    // ===== PHASE 1: Lexical Analysis =====
-    ifstream file(filename);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open file " << filename << "\n";
-        return 1;
-    }
-
-    stringstream buffer;
-    buffer << file.rdbuf();
-    string sourceCode = buffer.str();
-
-    Lexer lexer(sourceCode);
-    vector<Token> tokens = lexer.tokenize();
-
-    lexer.printTokens();
-
-    // Stop if lexical errors occurred
-    if (lexer.hasErrors()) {
-        cout << "\nCompilation stopped due to lexical errors.\n";
-        return 0;
-    }
-
-    // ===== PHASE 2: Syntax Analysis (Parsing & AST) =====
-    cout << "\n===== SYNTAX ANALYSIS (AST) =====\n";
-    Parser parser(tokens);
-    auto ast = parser.parse();
-    parser.printAST(ast);
-
-    // Stop if syntax errors occurred
-    if (parser.hasErrors()) {
-        cout << "\nCompilation stopped due to syntax errors.\n";
-        return 0;
-    }
-
-    // ===== PHASE 3: Semantic Analysis =====
-    SemanticAnalyzer semantic;
-    semantic.analyze(ast);
-
-    if (semantic.hasErrors()) {
-        cout << "\nCompilation stopped due to semantic errors.\n";
-        return 0;
-    }
-
-    // ===== PHASE 4: Intermediate Code Generation (ICG) =====
-    ICGGenerator icg;
-    icg.generate(ast);
-
-    vector<string> tac = icg.getCode();
-
-    cout << "\n===== INTERMEDIATE CODE (Before Optimization) =====\n";
-    for (auto &line : tac)
-        cout << line << "\n";
-
-    // ===== PHASE 5: Optimization =====
-    optimizeTAC(tac);
-
-    cout << "\n===== INTERMEDIATE CODE (After Optimization) =====\n";
-    for (auto &line : tac)
-        cout << line << "\n";
-
-    // ===== PHASE 6: Target Code Generation =====
-    cout << "\n===== TARGET PSEUDO-ASSEMBLY =====\n";
-    CodeGen cg;
-    vector<string> asmCode = cg.generate(tac);
-
-    for (auto &line : asmCode)
-        cout << line << "\n";
-
-    cout << "\nCompilation stages completed: "
-         << "Lexical + Syntax + Semantic + ICG + OPT + CODEGEN\n";
-
-    return 0;
-}
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+
+#include "token.h"
+#include "source.h"
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "tac.h"
+#include "icg.h"
+#include "opt.h"
+#include "codegen.h"
+#include "regalloc.h"
+#include "native.h"
+#include "vm.h"
+#include "watch.h"
+
+using namespace std;
+
+static void usage() {
+    cerr << "Usage: mini_compiler [options] <source_file | ->\n"
+         << "       mini_compiler --watch <source_file>\n"
+         << "Options:\n"
+         << "  -O0 .. -O3         optimization level (default -O2)\n"
+         << "  --passes=a,b,...   run exactly these passes, in order\n"
+         << "  --disable=a,b,...  leave these passes out\n"
+         << "  --time-passes      time each pass and count the instructions it changed\n"
+         << "  --remarks          report what each pass changed and why\n"
+         << "  --regs=N           size of the target register file (default 8, at least "
+         << MIN_REGISTERS << ")\n"
+         << "  -o <file>          also write a static x86-64 Linux executable\n"
+         << "  --jit              compile in memory, run, and print only the result\n"
+         << "  --run              run the optimized TAC on the bytecode VM\n"
+         << "  --run-unoptimized  run the TAC before optimization (with --run: compare)\n"
+         << "Passes: " << availablePasses() << "\n";
+}
+
+// Front end for --jit / --run: the phases run without their listings
+// (only diagnostics are shown). False if compilation stopped.
+static bool quietFrontEnd(const string &filename, vector<Quad> &tac) {
+    SourceInput source;
+    if (!source.open(filename)) {
+        cerr << "Error: Could not open file " << filename << "\n";
+        return false;
+    }
+    // One pass. Large mapped files are lexed on all cores into an array
+    // first; otherwise (or on one core) the parser pulls its tokens and
+    // lexical errors are reported as they are reached.
+    Lexer lexer(source);
+    AST ast;
+    bool parallel = source.isMapped() && source.size() >= 2 * Lexer::PARALLEL_MIN_CHUNK &&
+                    thread::hardware_concurrency() > 1;
+    const vector<Token> &tokens = parallel ? lexer.tokenizeParallel() : lexer.getTokens();
+    Parser parser = parallel ? Parser(lexer, tokens.data(), tokens.data() + tokens.size(), ast)
+                             : Parser(lexer, ast);
+    parser.parse();
+    if (lexer.hasErrors()) {
+        cout << "Compilation stopped due to lexical errors.\n";
+        return false;
+    }
+    if (parser.hasErrors()) {
+        cout << "Compilation stopped due to syntax errors.\n";
+        return false;
+    }
+
+    SemanticAnalyzer semantic(false);
+    semantic.analyze(ast);
+    if (semantic.hasErrors()) {
+        cout << "Compilation stopped due to semantic errors.\n";
+        return false;
+    }
+
+    ICGGenerator icg;
+    icg.generate(ast);
+    tac = icg.getCode();
+    return true;
+}
+
+// --jit: the optimized TAC is compiled into memory and called; its
+// result is printed with the time each step took.
+static int runJitMode(const string &filename, PassManager &passes) {
+    using Clock = chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+
+    vector<Quad> tac;
+    if (!quietFrontEnd(filename, tac)) return 1;
+    passes.run(tac);
+    double frontMillis = chrono::duration<double, milli>(Clock::now() - start).count();
+
+    JitRun run;
+    string error;
+    if (!runJit(tac, run, error)) {
+        cerr << "Error: " << error << "\n";
+        return 1;
+    }
+    if (!run.fault.empty()) {
+        cout << run.fault << "\n";
+        return 1;
+    }
+    cout << run.value << "\n";
+    cout << fixed << setprecision(3) << "[jit] front end " << frontMillis << " ms, compile "
+         << run.compileMillis << " ms, execute " << run.runMillis << " ms\n";
+    return 0;
+}
+
+// --run / --run-unoptimized: the TAC after / before optimization runs on
+// the bytecode VM. The result is printed, then per run the instructions
+// dispatched and the time; with both, the two results must agree.
+static int runVmMode(const string &filename, PassManager &passes, bool optimized, bool unoptimized) {
+    vector<Quad> tac;
+    if (!quietFrontEnd(filename, tac)) return 1;
+
+    struct Run {
+        const char *name;
+        VMResult result;
+    };
+    vector<Run> runs;
+    auto execute = [&](const char *name) {
+        Bytecode bc = compileBytecode(tac);
+        VM vm(bc);
+        VMResult result;
+        string error;
+        if (!vm.run(result, error)) {
+            cout << error << "\n";
+            return false;
+        }
+        runs.push_back({name, result});
+        return true;
+    };
+    if (unoptimized && !execute("unoptimized")) return 1;
+    passes.run(tac);
+    if (optimized && !execute("optimized")) return 1;
+
+    cout << runs.back().result.value << "\n";
+    for (const Run &r : runs)
+        cout << "[vm] " << r.name << ": " << r.result.value << ", " << r.result.dispatched
+             << " instructions dispatched, " << fixed << setprecision(3) << r.result.millis << " ms\n";
+    if (runs.size() == 2) {
+        int64_t before = runs[0].result.value, after = runs[1].result.value;
+        if (before != after) {
+            cout << "[vm] MISMATCH: the optimized program returns " << after
+                 << " instead of " << before << "\n";
+            return 1;
+        }
+        cout << "[vm] same result; " << runs[0].result.dispatched << " -> " << runs[1].result.dispatched
+             << " instructions dispatched\n";
+    }
+    return 0;
+}
+
+// "a,b,c" -> {"a", "b", "c"}
+static vector<string> splitList(const string &text) {
+    vector<string> items;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        if (comma == string::npos) comma = text.size();
+        if (comma > start) items.push_back(text.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return items;
+}
+
+int main(int argc, char* argv[]) {
+    string filename, watchFile, outputFile;
+    bool jit = false, run = false, runUnoptimized = false;
+    OptOptions optOptions;
+    int registers = 8;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--watch") {
+            if (i + 1 >= argc) {
+                cerr << "Usage: mini_compiler --watch <source_file>\n";
+                return 1;
+            }
+            watchFile = argv[++i];
+        } else if (arg == "-o") {
+            if (i + 1 >= argc) {
+                cerr << "Error: -o needs a file name\n";
+                return 1;
+            }
+            outputFile = argv[++i];
+        } else if (arg == "--jit") {
+            jit = true;
+        } else if (arg == "--run") {
+            run = true;
+        } else if (arg == "--run-unoptimized") {
+            runUnoptimized = true;
+        } else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3') {
+            optOptions.level = arg[2] - '0';
+        } else if (arg.rfind("--passes=", 0) == 0) {
+            optOptions.passes = splitList(arg.substr(9));
+        } else if (arg.rfind("--disable=", 0) == 0) {
+            optOptions.disabled = splitList(arg.substr(10));
+        } else if (arg == "--time-passes") {
+            optOptions.timePasses = true;
+        } else if (arg == "--remarks") {
+            optOptions.remarks = true;
+        } else if (arg.rfind("--regs=", 0) == 0) {
+            registers = atoi(arg.c_str() + 7);
+            if (registers < MIN_REGISTERS) {
+                cerr << "Error: --regs needs at least " << MIN_REGISTERS << " registers\n";
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            cerr << "Error: unknown option " << arg << "\n";
+            usage();
+            return 1;
+        } else {
+            filename = arg;
+        }
+    }
+    if (!watchFile.empty()) return runWatch(watchFile);
+    if (filename.empty()) {
+        usage();
+        return 1;
+    }
+
+    PassManager passes;
+    string passError;
+    if (!passes.configure(optOptions, passError)) {
+        cerr << "Error: " << passError << "\n";
+        return 1;
+    }
+    if (jit) return runJitMode(filename, passes);
+    if (run || runUnoptimized) return runVmMode(filename, passes, run, runUnoptimized);
+
+    cout << "=============================================\n";
+    cout << "        Mini C++ Compiler - Phase 1 to 6\n";
+    cout << "=============================================\n";
+    cout << "Compiling file: " << filename << "\n\n";
+
+    // ===== PHASE 1: Lexical Analysis =====
+    // Regular files are mapped and lexed in place (on all cores when they
+    // are large); pipes/stdin are streamed. The input is lexed once: the
+    // listing needs the tokens kept, and the parser then reads that array.
+    SourceInput source;
+    if (!source.open(filename)) {
+        cerr << "Error: Could not open file " << filename << "\n";
+        return 1;
+    }
+
+    Lexer lexer(source);
+    const vector<Token> &tokens = lexer.tokenizeParallel();    // reports lexical errors
+    lexer.printTokens();
+
+    // Stop if lexical errors occurred
+    if (lexer.hasErrors()) {
+        cout << "\nCompilation stopped due to lexical errors.\n";
+        return 0;
+    }
+
+    // ===== PHASE 2: Syntax Analysis (Parsing & AST) =====
+    cout << "\n===== SYNTAX ANALYSIS (AST) =====\n";
+    AST ast;    // every node of this compilation, freed together at exit
+    Parser parser(lexer, tokens.data(), tokens.data() + tokens.size(), ast);
+    parser.parse();
+    parser.printAST(ast.root);
+
+    // Stop if syntax errors occurred
+    if (parser.hasErrors()) {
+        cout << "\nCompilation stopped due to syntax errors.\n";
+        return 0;
+    }
+
+    // ===== PHASE 3: Semantic Analysis =====
+    SemanticAnalyzer semantic;
+    semantic.analyze(ast);
+
+    if (semantic.hasErrors()) {
+        cout << "\nCompilation stopped due to semantic errors.\n";
+        return 0;
+    }
+
+    // ===== PHASE 4: Intermediate Code Generation (ICG) =====
+    ICGGenerator icg;
+    icg.generate(ast);
+
+    vector<Quad> tac = icg.getCode();
+
+    cout << "\n===== INTERMEDIATE CODE (Before Optimization) =====\n";
+    for (auto &quad : tac)
+        cout << formatQuad(quad) << "\n";
+
+    // ===== PHASE 5: Optimization =====
+    passes.run(tac);
+
+    cout << "\n===== INTERMEDIATE CODE (After Optimization) =====\n";
+    for (auto &quad : tac)
+        cout << formatQuad(quad) << "\n";
+
+    if (optOptions.timePasses) {
+        cout << "\n===== OPTIMIZATION PASSES (" << passes.pipeline() << ") =====\n";
+        cout << left << setw(12) << "pass" << right << setw(10) << "ms"
+             << setw(8) << "before" << setw(8) << "after"
+             << setw(9) << "removed" << setw(7) << "added" << "\n";
+        for (const PassStats &st : passes.stats())
+            cout << left << setw(12) << st.pass << right << setw(10) << fixed << setprecision(3) << st.millis
+                 << setw(8) << st.before << setw(8) << st.after
+                 << setw(9) << st.removed << setw(7) << st.added << "\n";
+        cout.unsetf(ios::floatfield);
+    }
+    if (optOptions.remarks) {
+        cout << "\n===== OPTIMIZATION REMARKS =====\n";
+        for (const OptRemark &r : passes.remarks())
+            cout << "[" << r.pass << "] " << r.message << "\n";
+    }
+
+    // ===== PHASE 6: Target Code Generation =====
+    cout << "\n===== TARGET PSEUDO-ASSEMBLY =====\n";
+    CodeGen cg(registers, optOptions.level > 0);   // -O0 also skips the peephole pass
+    MachineFunction machine = cg.generate(tac);
+
+    for (auto &line : formatAssembly(machine))
+        cout << line << "\n";
+
+    // ===== PHASE 7: Native Executable (optional) =====
+    if (!outputFile.empty()) {
+        vector<uint8_t> image = buildElfExecutable(tac);
+        string writeError;
+        if (!writeExecutable(outputFile, image, writeError)) {
+            cerr << "Error: " << writeError << "\n";
+            return 1;
+        }
+        cout << "\n===== NATIVE EXECUTABLE =====\n";
+        cout << "Wrote " << outputFile << " (x86-64 ELF, " << image.size() << " bytes)\n";
+    }
+
+    cout << "\nCompilation stages completed: "
+         << "Lexical + Syntax + Semantic + ICG + OPT + CODEGEN\n";
+
+    return 0;
+}
@@ -0,0 +1,560 @@
+#include "native.h"
+#include "dataflow.h"
+#include "regalloc.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__)
+#define NATIVE_HAVE_JIT
+#endif
+#endif
+
+using namespace std;
+
+namespace {
+
+// Allocator register k -> general-purpose register. rax, rdx (idiv) and
+// r11 are scratch; rsp/rbp hold the frame.
+const X86Reg GPR[] = {RCX, RBX, RSI, RDI, R8, R9, R10, R12, R13, R14, R15};
+const int ALLOCATABLE = sizeof GPR / sizeof GPR[0];
+const uint8_t XMM_A = 15, XMM_B = 14;   // scratch xmm registers
+
+bool calleeSaved(X86Reg r) { return r == RBX || r >= R12; }
+
+class NativeLowering {
+public:
+    NativeLowering(X86Assembler &as, const vector<Quad> &code)
+        : as(as), code(code), vars(code), regs(code, ALLOCATABLE + 2) {}
+
+    X86Label emit();
+
+private:
+    X86Assembler &as;
+    const vector<Quad> &code;
+    OperandIndex vars;
+    RegisterAssignment regs;
+    unordered_map<uint32_t, int32_t> varSlot; // variables in memory: SymbolId -> frame slot
+    vector<X86Label> labels;                 // per TAC label id
+    vector<X86Reg> saved;                    // callee-saved registers pushed
+    X86Label divFault;                       // rdx = 1 and return, when used
+    bool faults = false;
+    int32_t frameSize = 0, slotBase = 0;
+
+    void prologue();
+    void epilogue();
+    void lower(const Quad &q);
+
+    // The type the IR gives it (tac.h)
+    bool typedDouble(const Operand &o) const { return o.isDouble(); }
+    // Where a variable/temp lives: its register (general-purpose or xmm,
+    // by type) or its frame slot
+    X86RM where(const Operand &o) const;
+    bool inGpr(const Operand &o, X86Reg r) const {
+        return vars.of(o) >= 0 && !typedDouble(o) && where(o).isReg(r);
+    }
+    bool inXmm(const Operand &o, uint8_t x) const {
+        return vars.of(o) >= 0 && typedDouble(o) && where(o).isReg(x);
+    }
+    X86Label labelFor(const Operand &l) { return labels[l.id]; }
+
+    void loadInt(X86Reg d, const Operand &o);
+    void loadDouble(uint8_t x, const Operand &o);
+    void storeInt(const Operand &dst, X86Reg s);
+    void storeDouble(const Operand &dst, uint8_t x);
+    void intBinary(const Quad &q);
+    void divide(const Quad &q);
+    void doubleBinary(const Quad &q);
+    void compare(const Quad &q);
+    void branch(const Quad &q);
+};
+
+X86RM NativeLowering::where(const Operand &o) const {
+    int32_t r = regs.regOf(o);
+    if (r >= 0) return X86RM::r(typedDouble(o) ? (uint8_t)r : (uint8_t)GPR[r]);
+    int32_t slot = regs.slotOf(o);
+    if (slot < 0) slot = varSlot.at(o.id);
+    return X86RM::m(-(slotBase + 8 * (slot + 1)));
+}
+
+// A double operand is truncated
+void NativeLowering::loadInt(X86Reg d, const Operand &o) {
+    if (o.kind == OperandKind::Float) as.movImm(d, truncateToInt(o.f));
+    else if (typedDouble(o)) as.cvttsd2si(d, where(o));
+    else if (o.kind == OperandKind::Int) as.movImm(d, o.i);
+    else if (o.kind == OperandKind::None) as.movImm(d, 0);
+    else if (!where(o).isReg(d)) as.mov(d, where(o));
+}
+
+void NativeLowering::loadDouble(uint8_t x, const Operand &o) {
+    if (o.isConst()) {
+        double v = (o.kind == OperandKind::Float) ? o.f : (double)o.i;
+        int64_t bits;
+        memcpy(&bits, &v, sizeof bits);
+        if (bits == 0) {
+            as.xorpd(x, x);
+        } else {
+            as.movImm(RAX, bits);
+            as.movq(x, RAX);
+        }
+    } else if (!typedDouble(o)) {
+        as.cvtsi2sd(x, where(o));
+    } else if (!where(o).isReg(x)) {
+        as.movsd(x, where(o));
+    }
+}
+
+void NativeLowering::storeInt(const Operand &dst, X86Reg s) {
+    X86RM d = where(dst);
+    if (typedDouble(dst)) {
+        // an integer into a double variable: convert
+        if (d.mem) {
+            as.cvtsi2sd(XMM_A, X86RM::r(s));
+            as.movsd(d, XMM_A);
+        } else {
+            as.cvtsi2sd(d.reg, X86RM::r(s));
+        }
+    } else if (d.mem) {
+        as.mov(d, s);
+    } else if (d.reg != s) {
+        as.mov((X86Reg)d.reg, X86RM::r(s));
+    }
+}
+
+void NativeLowering::storeDouble(const Operand &dst, uint8_t x) {
+    if (!typedDouble(dst)) {
+        // a double into an integer variable: truncate
+        as.cvttsd2si(RAX, X86RM::r(x));
+        storeInt(dst, RAX);
+        return;
+    }
+    X86RM d = where(dst);
+    if (d.mem) as.movsd(d, x);
+    else if (d.reg != x) as.movsd(d.reg, X86RM::r(x));
+}
+
+// Computed in the destination's register when it has one that B is not
+// in, otherwise in rax (like the pseudo-assembly's scratch)
+void NativeLowering::intBinary(const Quad &q) {
+    if (q.op == Opcode::Div) {
+        divide(q);
+        return;
+    }
+
+    X86RM d = where(q.dst);
+    X86Reg w = RAX;
+    if (!typedDouble(q.dst) && !d.mem && !inGpr(q.b, (X86Reg)d.reg)) w = (X86Reg)d.reg;
+    loadInt(w, q.a);
+
+    bool imm = q.b.kind == OperandKind::Int && q.b.i == (int32_t)q.b.i;
+    X86RM b = X86RM::r(RDX);
+    if (!imm) {
+        if (q.b.isConst()) as.movImm(RDX, q.b.i);
+        else b = where(q.b);
+    }
+    if (q.op == Opcode::Mul) {
+        if (imm) as.imul(w, X86RM::r(w), (int32_t)q.b.i);
+        else as.imul(w, b);
+    } else {
+        X86Alu op = (q.op == Opcode::Add) ? X86Alu::Add : X86Alu::Sub;
+        if (imm) as.alu(op, X86RM::r(w), (int32_t)q.b.i);
+        else as.alu(op, w, b);
+    }
+    storeInt(q.dst, w);
+}
+
+// idiv traps on a zero divisor and on INT64_MIN / -1: zero goes to the
+// fault exit, -1 negates (wrapping) instead of dividing
+void NativeLowering::divide(const Quad &q) {
+    if (!faults) {
+        divFault = as.newLabel();
+        faults = true;
+    }
+    loadInt(RAX, q.a);
+    auto negate = [&] {
+        as.movImm(RDX, 0);
+        as.alu(X86Alu::Sub, RDX, X86RM::r(RAX));
+        as.mov(RAX, X86RM::r(RDX));
+    };
+    if (q.b.isConst()) {
+        int64_t v = q.b.kind == OperandKind::Int ? q.b.i : 0;
+        if (v == 0) {
+            as.jmp(divFault);
+            return;
+        }
+        if (v == -1) {
+            negate();
+        } else {
+            as.movImm(R11, v);
+            as.cqo();
+            as.idiv(X86RM::r(R11));
+        }
+    } else {
+        X86RM divisor = where(q.b);
+        X86Label minusOne = as.newLabel(), done = as.newLabel();
+        as.alu(X86Alu::Cmp, divisor, 0);
+        as.jcc(X86Cond::E, divFault);
+        as.alu(X86Alu::Cmp, divisor, -1);
+        as.jcc(X86Cond::E, minusOne);
+        as.cqo();
+        as.idiv(divisor);
+        as.jmp(done);
+        as.bind(minusOne);
+        negate();
+        as.bind(done);
+    }
+    storeInt(q.dst, RAX);
+}
+
+void NativeLowering::doubleBinary(const Quad &q) {
+    X86RM d = where(q.dst);
+    uint8_t w = XMM_A;
+    if (typedDouble(q.dst) && !d.mem && !inXmm(q.b, d.reg)) w = d.reg;
+    loadDouble(w, q.a);
+
+    X86RM b = X86RM::r(XMM_B);
+    if (typedDouble(q.b) && !q.b.isConst()) b = where(q.b);
+    else loadDouble(XMM_B, q.b);
+    X86Sse op = q.op == Opcode::Add ? X86Sse::Add
+              : q.op == Opcode::Sub ? X86Sse::Sub
+              : q.op == Opcode::Mul ? X86Sse::Mul : X86Sse::Div;
+    as.sse(op, w, b);
+    storeDouble(q.dst, w);
+}
+
+// 0/1 into the destination. Doubles compare like C: anything involving
+// NaN is false, except !=.
+void NativeLowering::compare(const Quad &q) {
+    if (typedDouble(q.a) || typedDouble(q.b)) {
+        // a < b is b > a: "above" conditions are false when unordered
+        bool swap = q.op == Opcode::Lt || q.op == Opcode::Le;
+        const Operand &x = swap ? q.b : q.a, &y = swap ? q.a : q.b;
+        uint8_t xr = XMM_A;
+        if (typedDouble(x) && !x.isConst() && !where(x).mem) xr = where(x).reg;
+        else loadDouble(XMM_A, x);
+        X86RM yr = X86RM::r(XMM_B);
+        if (typedDouble(y) && !y.isConst()) yr = where(y);
+        else loadDouble(XMM_B, y);
+        as.ucomisd(xr, yr);
+
+        if (q.op == Opcode::Eq || q.op == Opcode::Ne) {
+            bool eq = q.op == Opcode::Eq;
+            as.setcc(eq ? X86Cond::E : X86Cond::NE, RAX);
+            as.setcc(eq ? X86Cond::NP : X86Cond::P, RDX);
+            as.movzxByte(RAX, RAX);
+            as.movzxByte(RDX, RDX);
+            as.alu(eq ? X86Alu::And : X86Alu::Or, RAX, X86RM::r(RDX));
+        } else {
+            bool strict = q.op == Opcode::Lt || q.op == Opcode::Gt;
+            as.setcc(strict ? X86Cond::A : X86Cond::AE, RAX);
+            as.movzxByte(RAX, RAX);
+        }
+        storeInt(q.dst, RAX);
+        return;
+    }
+
+    X86Reg x = RAX;
+    if (!q.a.isConst() && !where(q.a).mem) x = (X86Reg)where(q.a).reg;
+    else loadInt(RAX, q.a);
+    if (q.b.kind == OperandKind::Int && q.b.i == (int32_t)q.b.i) {
+        as.alu(X86Alu::Cmp, X86RM::r(x), (int32_t)q.b.i);
+    } else if (q.b.isConst()) {
+        as.movImm(RDX, q.b.i);
+        as.alu(X86Alu::Cmp, x, X86RM::r(RDX));
+    } else {
+        as.alu(X86Alu::Cmp, x, where(q.b));
+    }
+    X86Cond cc = q.op == Opcode::Lt ? X86Cond::L
+               : q.op == Opcode::Le ? X86Cond::LE
+               : q.op == Opcode::Gt ? X86Cond::G
+               : q.op == Opcode::Ge ? X86Cond::GE
+               : q.op == Opcode::Eq ? X86Cond::E : X86Cond::NE;
+    as.setcc(cc, RAX);
+    as.movzxByte(RAX, RAX);
+    storeInt(q.dst, RAX);
+}
+
+// if / ifFalse: the condition is true when it is not 0 (NaN is true)
+void NativeLowering::branch(const Quad &q) {
+    X86Label target = labelFor(q.b);
+    bool onTrue = q.op == Opcode::IfGoto;
+    if (q.a.isConst()) {
+        if (jumpTaken(q, q.a)) as.jmp(target);
+        return;
+    }
+    X86RM c = where(q.a);
+    if (!typedDouble(q.a)) {
+        if (c.mem) as.alu(X86Alu::Cmp, c, 0);
+        else as.test((X86Reg)c.reg, (X86Reg)c.reg);
+        as.jcc(onTrue ? X86Cond::NE : X86Cond::E, target);
+        return;
+    }
+    as.xorpd(XMM_B, XMM_B);
+    uint8_t x = XMM_A;
+    if (c.mem) as.movsd(XMM_A, c);
+    else x = c.reg;
+    as.ucomisd(x, X86RM::r(XMM_B));
+    if (onTrue) {
+        as.jcc(X86Cond::NE, target);
+        as.jcc(X86Cond::P, target);
+    } else {
+        X86Label skip = as.newLabel();
+        as.jcc(X86Cond::P, skip);
+        as.jcc(X86Cond::E, target);
+        as.bind(skip);
+    }
+}
+
+void NativeLowering::lower(const Quad &q) {
+    switch (q.op) {
+        case Opcode::Label:
+            as.bind(labelFor(q.a));
+            break;
+        case Opcode::Goto:
+            as.jmp(labelFor(q.a));
+            break;
+        case Opcode::IfGoto:
+        case Opcode::IfFalseGoto:
+            branch(q);
+            break;
+        case Opcode::Return:
+            loadInt(RAX, q.a);
+            as.alu(X86Alu::Xor, RDX, X86RM::r(RDX));
+            epilogue();
+            break;
+        case Opcode::Copy: {
+            if (q.a == q.dst) break;
+            X86RM d = where(q.dst);
+            if (typedDouble(q.dst)) {
+                if (!d.mem) loadDouble(d.reg, q.a);
+                else if (typedDouble(q.a) && !q.a.isConst() && !where(q.a).mem) as.movsd(d, where(q.a).reg);
+                else {
+                    loadDouble(XMM_A, q.a);
+                    as.movsd(d, XMM_A);
+                }
+            } else if (!d.mem) {
+                loadInt((X86Reg)d.reg, q.a);
+            } else if (q.a.kind == OperandKind::Int && q.a.i == (int32_t)q.a.i) {
+                as.movImm(d, (int32_t)q.a.i);
+            } else if (!q.a.isConst() && !typedDouble(q.a) && !where(q.a).mem) {
+                as.mov(d, (X86Reg)where(q.a).reg);
+            } else {
+                loadInt(RAX, q.a);
+                as.mov(d, RAX);
+            }
+            break;
+        }
+        default:
+            if (isRelational(q.op)) compare(q);
+            else if (typedDouble(q.a) || typedDouble(q.b)) doubleBinary(q);
+            else intBinary(q);
+            break;
+    }
+}
+
+// push rbp; mov rbp, rsp; push the callee-saved registers in use; make
+// room for the frame slots; zero every register and slot in use
+void NativeLowering::prologue() {
+    vector<char> gprUsed(ALLOCATABLE, 0), xmmUsed(ALLOCATABLE, 0);
+    int32_t slots = (int32_t)regs.spillSlots;
+    for (const Quad &q : code)
+        for (const Operand *o : {&q.dst, &q.a, &q.b}) {
+            if (vars.of(*o) < 0) continue;
+            int32_t r = regs.regOf(*o);
+            if (r >= 0) (typedDouble(*o) ? xmmUsed : gprUsed)[r] = 1;
+            else if (o->kind == OperandKind::Var && !varSlot.count(o->id)) varSlot[o->id] = slots++;
+        }
+    for (int r = 0; r < ALLOCATABLE; ++r)
+        if (gprUsed[r] && calleeSaved(GPR[r])) saved.push_back(GPR[r]);
+
+    as.push(RBP);
+    as.mov(RBP, X86RM::r(RSP));
+    for (X86Reg r : saved) as.push(r);
+    slotBase = 8 * (int32_t)saved.size();
+    // keep rsp 16-byte aligned
+    frameSize = 8 * slots;
+    if ((slotBase + frameSize) % 16) frameSize += 8;
+    if (frameSize) as.alu(X86Alu::Sub, X86RM::r(RSP), frameSize);
+
+    for (int r = 0; r < ALLOCATABLE; ++r) {
+        if (gprUsed[r]) as.alu(X86Alu::Xor, GPR[r], X86RM::r(GPR[r]));
+        if (xmmUsed[r]) as.xorpd((uint8_t)r, (uint8_t)r);
+    }
+    for (int32_t s = 0; s < slots; ++s) as.movImm(X86RM::m(-(slotBase + 8 * (s + 1))), 0);
+}
+
+void NativeLowering::epilogue() {
+    if (frameSize) as.alu(X86Alu::Add, X86RM::r(RSP), frameSize);
+    for (size_t k = saved.size(); k-- > 0;) as.pop(saved[k]);
+    as.pop(RBP);
+    as.ret();
+}
+
+X86Label NativeLowering::emit() {
+    for (const Quad &q : code)
+        for (const Operand *o : {&q.dst, &q.a, &q.b})
+            if (o->kind == OperandKind::Label && o->id >= labels.size()) labels.resize(o->id + 1, X86Label{0});
+    for (X86Label &l : labels) l = as.newLabel();
+
+    X86Label entry = as.newLabel();
+    as.bind(entry);
+    prologue();
+    for (const Quad &q : code) lower(q);
+    // falling off the end returns 0
+    if (code.empty() || code.back().op != Opcode::Return) {
+        as.movImm(RAX, 0);
+        as.alu(X86Alu::Xor, RDX, X86RM::r(RDX));
+        epilogue();
+    }
+    if (faults) {
+        as.bind(divFault);
+        as.movImm(RDX, 1);
+        epilogue();
+    }
+    return entry;
+}
+
+} // namespace
+
+X86Label emitNativeFunction(X86Assembler &as, const vector<Quad> &tac) {
+    NativeLowering lowering(as, tac);
+    return lowering.emit();
+}
+
+// -----------------------------
+// ELF64 executable
+// -----------------------------
+namespace {
+
+const uint64_t LOAD_ADDRESS = 0x400000;
+const size_t EHDR_SIZE = 64, PHDR_SIZE = 56;
+const char DIV_BY_ZERO[] = "Runtime Error: integer division by zero";
+
+void put(vector<uint8_t> &out, size_t at, uint64_t value, int bytes) {
+    for (int k = 0; k < bytes; ++k) out[at + k] = (uint8_t)(value >> (8 * k));
+}
+
+} // namespace
+
+// One PT_LOAD segment (R+X) maps the whole file; no section headers.
+vector<uint8_t> buildElfExecutable(const vector<Quad> &tac) {
+    X86Assembler as;
+    X86Label fn = emitNativeFunction(as, tac);
+    // _start: exit(main()), or on a fault write(2, message) and exit(1)
+    size_t start = as.code.size();
+    X86Label fault = as.newLabel();
+    as.call(fn);
+    as.test(RDX, RDX);
+    as.jcc(X86Cond::NE, fault);
+    as.mov(RDI, X86RM::r(RAX));
+    as.movImm(RAX, 60);   // SYS_exit
+    as.syscall();
+    as.bind(fault);
+    as.movImm(RDI, 2);
+    as.movImm(RSI, INT64_MAX);   // imm64 form, patched to the message address below
+    size_t messageField = as.code.size() - 8;
+    as.movImm(RDX, (int64_t)sizeof DIV_BY_ZERO);   // the message and '\n'
+    as.movImm(RAX, 1);    // SYS_write
+    as.syscall();
+    as.movImm(RDI, 1);
+    as.movImm(RAX, 60);
+    as.syscall();
+    as.finish();
+
+    size_t codeAt = EHDR_SIZE + PHDR_SIZE;
+    size_t messageAt = codeAt + as.code.size();
+    vector<uint8_t> image(messageAt + sizeof DIV_BY_ZERO, 0);
+    memcpy(image.data() + codeAt, as.code.data(), as.code.size());
+    memcpy(image.data() + messageAt, DIV_BY_ZERO, sizeof DIV_BY_ZERO - 1);
+    image[messageAt + sizeof DIV_BY_ZERO - 1] = '\n';
+    put(image, codeAt + messageField, LOAD_ADDRESS + messageAt, 8);
+
+    // ELF header
+    const uint8_t ident[] = {0x7F, 'E', 'L', 'F', 2 /* 64-bit */, 1 /* little endian */, 1 /* version */};
+    memcpy(image.data(), ident, sizeof ident);
+    put(image, 16, 2, 2);                          // e_type: ET_EXEC
+    put(image, 18, 0x3E, 2);                       // e_machine: x86-64
+    put(image, 20, 1, 4);                          // e_version
+    put(image, 24, LOAD_ADDRESS + codeAt + start, 8);  // e_entry
+    put(image, 32, EHDR_SIZE, 8);                  // e_phoff
+    put(image, 52, EHDR_SIZE, 2);                  // e_ehsize
+    put(image, 54, PHDR_SIZE, 2);                  // e_phentsize
+    put(image, 56, 1, 2);                          // e_phnum
+
+    // Program header
+    size_t ph = EHDR_SIZE;
+    put(image, ph + 0, 1, 4);                      // p_type: PT_LOAD
+    put(image, ph + 4, 5, 4);                      // p_flags: R+X
+    put(image, ph + 16, LOAD_ADDRESS, 8);          // p_vaddr
+    put(image, ph + 24, LOAD_ADDRESS, 8);          // p_paddr
+    put(image, ph + 32, image.size(), 8);          // p_filesz
+    put(image, ph + 40, image.size(), 8);          // p_memsz
+    put(image, ph + 48, 0x1000, 8);                // p_align
+    return image;
+}
+
+bool writeExecutable(const string &path, const vector<uint8_t> &image, string &error) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out || !out.write((const char *)image.data(), (streamsize)image.size())) {
+        error = "Could not write " + path;
+        return false;
+    }
+    out.close();
+#if defined(__unix__) || defined(__APPLE__)
+    if (chmod(path.c_str(), 0755) != 0) {
+        error = "Could not make " + path + " executable";
+        return false;
+    }
+#endif
+    return true;
+}
+
+// -----------------------------
+// JIT
+// -----------------------------
+bool runJit(const vector<Quad> &tac, JitRun &run, string &error) {
+#ifdef NATIVE_HAVE_JIT
+    using Clock = chrono::steady_clock;
+    auto millis = [](Clock::duration d) { return chrono::duration<double, milli>(d).count(); };
+
+    Clock::time_point start = Clock::now();
+    X86Assembler as;
+    emitNativeFunction(as, tac);   // the only code: it starts at offset 0
+    as.finish();
+
+    size_t size = as.code.size();
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        error = "Could not map memory for the JIT";
+        return false;
+    }
+    memcpy(mem, as.code.data(), size);
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        error = "Could not make the JIT code executable";
+        return false;
+    }
+    Clock::time_point compiled = Clock::now();
+
+    struct Result { int64_t value, fault; };   // rax, rdx
+    Result (*fn)() = reinterpret_cast<Result (*)()>(mem);
+    Result result = fn();
+    run.value = result.value;
+    run.fault = result.fault ? DIV_BY_ZERO : "";
+    Clock::time_point finished = Clock::now();
+    munmap(mem, size);
+
+    run.compileMillis = millis(compiled - start);
+    run.runMillis = millis(finished - compiled);
+    return true;
+#else
+    (void)tac;
+    (void)run;
+    error = "--jit needs an x86-64 Unix host";
+    return false;
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tac.h"
+#include "x86.h"
+
+// x86-64 System V backend: TAC straight to machine code (x86.h), no
+// assembler or linker involved.
+// - Every temp and variable has the type the IR gives it (tac.h), and a
+//   store converts to it: cvtsi2sd widens, cvttsd2si truncates.
+// - The linear-scan allocator (regalloc.h) hands out eleven registers;
+//   allocator register k is a general-purpose register for
+//   integer values and xmm k for doubles. rax/rdx/r11 and xmm14/xmm15 are
+//   scratch. Spilled values live in the rbp frame.
+// - Uninitialized values read as 0, like in the pseudo-assembly.
+// - The function returns its value in rax (a double is truncated) and a
+//   fault code in rdx: 0, or 1 after an integer division by zero, the
+//   VM's runtime error. INT64_MIN / -1 wraps, like the VM and folding.
+//   In C terms it is `struct { int64_t value, fault; } f(void)`.
+
+// Appends the function for `tac` to `as` at a fresh label, returned
+X86Label emitNativeFunction(X86Assembler &as, const std::vector<Quad> &tac);
+
+// Static ELF64 executable for Linux: _start calls the function and
+// exits with its return value as the status (on a fault: the runtime
+// error on stderr, status 1)
+std::vector<uint8_t> buildElfExecutable(const std::vector<Quad> &tac);
+
+// Writes the image and marks it executable; false with a message on failure
+bool writeExecutable(const std::string &path, const std::vector<uint8_t> &image, std::string &error);
+
+// In-process JIT (x86-64 Unix hosts): the function is written to a
+// read-write mapping that is then switched to read-execute (never both
+// at once), called, and unmapped.
+struct JitRun {
+    int64_t value;          // what the function returned
+    std::string fault;      // runtime error, empty if it returned normally
+    double compileMillis;   // encoding and mapping
+    double runMillis;       // the call itself
+};
+bool runJit(const std::vector<Quad> &tac, JitRun &run, std::string &error);
+
+#endif // NATIVE_H
@@ -1,263 +1,1080 @@
-#include "opt.h"
-#include <sstream>
-#include <unordered_map>
-#include <unordered_set>
-#include <cctype>
-#include <cstdlib>
-#include <iomanip>
-#include <iostream>
-
-using namespace std;
-
-// Helper: is numeric (int or float)
-static bool isNumber(const string &s) {
-    if (s.empty()) return false;
-    bool hasDot = false;
-    size_t i = 0;
-    if (s[0] == '+' || s[0] == '-') i = 1;
-    for (; i < s.size(); ++i) {
-        if (s[i] == '.') {
-            if (hasDot) return false;
-            hasDot = true;
-            continue;
-        }
-        if (!isdigit((unsigned char)s[i])) return false;
-    }
-    return true;
-}
-
-// Split a line into tokens (space-separated)
-static vector<string> splitTok(const string &line) {
-    vector<string> out;
-    istringstream iss(line);
-    string t;
-    while (iss >> t) out.push_back(t);
-    return out;
-}
-
-// Join tokens with spaces
-static string joinTok(const vector<string> &toks) {
-    string s;
-    for (size_t i = 0; i < toks.size(); ++i) {
-        if (i) s += " ";
-        s += toks[i];
-    }
-    return s;
-}
-
-// Try to compute simple binary op for numeric constants
-static bool computeConst(const string &a, const string &op, const string &b, string &out) {
-    if (!isNumber(a) || !isNumber(b)) return false;
-    bool isFloat = (a.find('.') != string::npos) || (b.find('.') != string::npos);
-    try {
-        if (isFloat) {
-            double da = stod(a);
-            double db = stod(b);
-            double res = 0.0;
-            if (op == "+") res = da + db;
-            else if (op == "-") res = da - db;
-            else if (op == "*") res = da * db;
-            else if (op == "/") { if (db == 0) return false; res = da / db; }
-            else if (op == "<") { out = (da < db) ? "1" : "0"; return true; }
-            else if (op == "<=") { out = (da <= db) ? "1" : "0"; return true; }
-            else if (op == ">") { out = (da > db) ? "1" : "0"; return true; }
-            else if (op == ">=") { out = (da >= db) ? "1" : "0"; return true; }
-            else if (op == "==") { out = (da == db) ? "1" : "0"; return true; }
-            else if (op == "!=") { out = (da != db) ? "1" : "0"; return true; }
-            else return false;
-            ostringstream oss;
-            oss << std::setprecision(12) << res;
-            out = oss.str();
-            if (out.find('.') != string::npos) {
-                while (!out.empty() && out.back() == '0') out.pop_back();
-                if (!out.empty() && out.back() == '.') out.pop_back();
-            }
-            return true;
-        } else {
-            long long ia = stoll(a);
-            long long ib = stoll(b);
-            long long r = 0;
-            if (op == "+") r = ia + ib;
-            else if (op == "-") r = ia - ib;
-            else if (op == "*") r = ia * ib;
-            else if (op == "/") { if (ib == 0) return false; r = ia / ib; }
-            else if (op == "<") { out = (ia < ib) ? "1" : "0"; return true; }
-            else if (op == "<=") { out = (ia <= ib) ? "1" : "0"; return true; }
-            else if (op == ">") { out = (ia > ib) ? "1" : "0"; return true; }
-            else if (op == ">=") { out = (ia >= ib) ? "1" : "0"; return true; }
-            else if (op == "==") { out = (ia == ib) ? "1" : "0"; return true; }
-            else if (op == "!=") { out = (ia != ib) ? "1" : "0"; return true; }
-            else return false;
-            out = to_string(r);
-            return true;
-        }
-    } catch (...) { return false; }
-}
-
-// One pass of optimization. Returns true if code was changed.
-static bool optimizationPass(vector<string> &code) {
-    if (code.empty()) return false;
-    bool changedAny = false;
-
-    // 1) Build definitions for temporaries: tX -> (line index, tokens)
-    unordered_map<string,int> defLine;
-    unordered_map<string, vector<string>> defTokens;
-
-    for (size_t i = 0; i < code.size(); ++i) {
-        auto toks = splitTok(code[i]);
-        if (toks.size() >= 3 && toks[1] == "=") {
-            string lhs = toks[0];
-            if (!lhs.empty() && lhs[0] == 't') {
-                defLine[lhs] = (int)i;
-                defTokens[lhs] = toks;
-            }
-        }
-    }
-
-    // containers for changes
-    unordered_set<int> removeLines;                 // lines to remove
-    unordered_map<string,string> replaceWithConst;  // temp -> replacement token (const or var)
-
-    // 2) Constant folding & algebraic simplification for temp definitions
-    for (auto &p : defTokens) {
-        const string &temp = p.first;
-        const vector<string> &toks = p.second;
-        if (toks.size() == 5) {
-            string a = toks[2], op = toks[3], b = toks[4];
-            string result;
-
-            // Constant folding
-            if (computeConst(a, op, b, result)) {
-                replaceWithConst[temp] = result;
-                removeLines.insert(defLine[temp]);
-                changedAny = true;
-                continue;
-            }
-
-            // Algebraic simplifications (x + 0, x * 1, x * 0, x / 1, etc.)
-            if (op == "+" && b == "0") { replaceWithConst[temp] = a; removeLines.insert(defLine[temp]); changedAny = true; }
-            else if (op == "+" && a == "0") { replaceWithConst[temp] = b; removeLines.insert(defLine[temp]); changedAny = true; }
-            else if (op == "-" && b == "0") { replaceWithConst[temp] = a; removeLines.insert(defLine[temp]); changedAny = true; }
-            else if (op == "*" && b == "1") { replaceWithConst[temp] = a; removeLines.insert(defLine[temp]); changedAny = true; }
-            else if (op == "*" && a == "1") { replaceWithConst[temp] = b; removeLines.insert(defLine[temp]); changedAny = true; }
-            else if (op == "*" && (a == "0" || b == "0")) { replaceWithConst[temp] = "0"; removeLines.insert(defLine[temp]); changedAny = true; }
-            else if (op == "/" && b == "1") { replaceWithConst[temp] = a; removeLines.insert(defLine[temp]); changedAny = true; }
-        } else if (toks.size() == 3) {
-            // t = X  (direct copy) -> can be propagated
-            replaceWithConst[temp] = toks[2];
-            removeLines.insert(defLine[temp]);
-            changedAny = true;
-        }
-    }
-
-    // 3) Apply replaceWithConst to all lines (replace tokens equal to temp)
-    for (size_t i = 0; i < code.size(); ++i) {
-        if (removeLines.count((int)i)) continue; // will be removed
-        string before = code[i];
-        auto toks = splitTok(code[i]);
-        bool changedLine = false;
-        for (size_t j = 0; j < toks.size(); ++j) {
-            auto it = replaceWithConst.find(toks[j]);
-            if (it != replaceWithConst.end()) {
-                toks[j] = it->second;
-                changedLine = true;
-            }
-        }
-        if (changedLine) {
-            code[i] = joinTok(toks);
-            changedAny = true;
-        }
-    }
-
-    // 4) Recompute defTokens/defLine for remaining temps (since we removed some)
-    defLine.clear();
-    defTokens.clear();
-    for (size_t i = 0; i < code.size(); ++i) {
-        if (removeLines.count((int)i)) continue;
-        auto toks = splitTok(code[i]);
-        if (toks.size() >= 3 && toks[1] == "=") {
-            string lhs = toks[0];
-            if (!lhs.empty() && lhs[0] == 't') {
-                defLine[lhs] = (int)i;
-                defTokens[lhs] = toks;
-            }
-        }
-    }
-
-    // 5) Count uses of temps
-    unordered_map<string,int> useCount;
-    for (size_t i = 0; i < code.size(); ++i) {
-        if (removeLines.count((int)i)) continue;
-        auto toks = splitTok(code[i]);
-        for (auto &tk : toks) {
-            if (!tk.empty() && tk[0] == 't') useCount[tk]++;
-        }
-    }
-
-    // 6) Inline temps used exactly once
-    for (auto &p : defTokens) {
-        const string &temp = p.first;
-        const vector<string> &toks = p.second;
-        if (useCount[temp] == 1 && defLine.count(temp)) {
-            int defIdx = defLine[temp];
-
-            // find the single use and replace
-            for (size_t i = 0; i < code.size(); ++i) {
-                if (removeLines.count((int)i)) continue;
-                if ((int)i == defIdx) continue;
-                auto useToks = splitTok(code[i]);
-                bool changedLine = false;
-                for (size_t j = 0; j < useToks.size(); ++j) {
-                    if (useToks[j] == temp) {
-                        if (toks.size() == 5) { // t = A op B
-                            // replace temp token by "A op B" (as three tokens)
-                            // splice tokens
-                            vector<string> newT;
-                            for (size_t k=0;k<j;++k) newT.push_back(useToks[k]);
-                            newT.push_back(toks[2]);
-                            newT.push_back(toks[3]);
-                            newT.push_back(toks[4]);
-                            for (size_t k=j+1;k<useToks.size();++k) newT.push_back(useToks[k]);
-                            useToks.swap(newT);
-                            changedLine = true;
-                        } else if (toks.size() == 3) { // t = X
-                            useToks[j] = toks[2];
-                            changedLine = true;
-                        }
-                        // don't break; continue scanning in case multiple occurrences (though useCount==1)
-                    }
-                }
-                if (changedLine) {
-                    string oldLine = code[i];
-                    code[i] = joinTok(useToks);
-                    if (code[i] != oldLine) changedAny = true;
-                }
-            }
-
-            // schedule temp definition removal
-            removeLines.insert(defIdx);
-        }
-    }
-
-    // 7) Rebuild code skipping removed lines
-    vector<string> newCode;
-    for (size_t i = 0; i < code.size(); ++i) {
-        if (removeLines.count((int)i)) continue;
-        newCode.push_back(code[i]);
-    }
-
-    if (newCode.size() != code.size()) changedAny = true;
-    code.swap(newCode);
-
-    return changedAny;
-}
-
-void optimizeTAC(vector<string> &code) {
-    if (code.empty()) return;
-
-    // Run multiple passes until no change
-    while (true) {
-        bool changed = optimizationPass(code);
-        if (!changed) break;
-    }
-}
+#include "opt.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "ssa.h"
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+// -----------------------------
+// Worklist optimizer
+// -----------------------------
+// Every temporary is defined once (ICG never reassigns one) and lives
+// inside one statement. Def-use chains are built once; after that an
+// instruction is looked at again only when one of its operands changed or
+// its result lost its last use, so the whole optimization is near-linear.
+namespace {
+
+// Where a pass reports what it did; passes get a null sink when remarks
+// are off so that no text is built
+struct RemarkSink {
+    const char *pass;
+    vector<OptRemark> &out;
+    void add(string message) { out.push_back({pass, std::move(message)}); }
+};
+
+string quoted(const Quad &q) { return "'" + formatQuad(q) + "'"; }
+
+struct Use {
+    uint32_t instr;
+    uint8_t slot;         // 1 = operand a, 2 = operand b
+    int32_t next;         // next use of the same temp, -1 at the end
+};
+
+class Optimizer {
+public:
+    Optimizer(vector<Quad> &c, RemarkSink *r) : code(c), remarks(r) {}
+    void run();
+
+private:
+    vector<Quad> &code;
+    RemarkSink *remarks;
+    vector<char> removed;
+    vector<int32_t> prevLive, nextLive;   // list of the remaining instructions
+
+    vector<int32_t> def;                  // temp -> defining instruction (-1: none)
+    vector<char> multiDef;                // temp assigned more than once: left alone
+    vector<int32_t> firstUse;             // temp -> head of its use chain
+    vector<uint32_t> useCount;            // temp -> operands currently reading it
+    vector<Use> uses;                     // chains; stale entries are skipped
+
+    vector<uint32_t> queue;               // instructions to (re)visit
+    size_t queueHead = 0;
+    vector<char> queued;
+
+    Operand &slotOf(uint32_t i, uint8_t slot) { return slot == 1 ? code[i].a : code[i].b; }
+    void addUse(uint32_t i, uint8_t slot);
+    void setOperand(uint32_t i, uint8_t slot, const Operand &o);
+    void dropUse(const Operand &o);
+    void enqueue(int32_t i);
+    void remove(uint32_t i);
+    void visit(uint32_t i);
+};
+
+// Does this quad assign a temporary?
+bool definesTemp(const Quad &q) {
+    return (q.op == Opcode::Copy || isBinary(q.op)) && q.dst.isTemp();
+}
+
+void Optimizer::enqueue(int32_t i) {
+    if (i < 0 || removed[i] || queued[i]) return;
+    queued[i] = 1;
+    queue.push_back((uint32_t)i);
+}
+
+// Record that operand `slot` of instruction i reads a temp
+void Optimizer::addUse(uint32_t i, uint8_t slot) {
+    const Operand &o = slotOf(i, slot);
+    if (!o.isTemp()) return;
+    uses.push_back({i, slot, firstUse[o.id]});
+    firstUse[o.id] = (int32_t)uses.size() - 1;
+    useCount[o.id]++;
+}
+
+// A read of `o` went away: a temp that is no longer read may be dead
+void Optimizer::dropUse(const Operand &o) {
+    if (!o.isTemp()) return;
+    if (--useCount[o.id] == 0) enqueue(def[o.id]);
+}
+
+void Optimizer::setOperand(uint32_t i, uint8_t slot, const Operand &o) {
+    Operand old = slotOf(i, slot);
+    slotOf(i, slot) = o;
+    addUse(i, slot);
+    dropUse(old);
+}
+
+void Optimizer::remove(uint32_t i) {
+    removed[i] = 1;
+    if (prevLive[i] >= 0) nextLive[prevLive[i]] = nextLive[i];
+    if (nextLive[i] >= 0) prevLive[nextLive[i]] = prevLive[i];
+    dropUse(code[i].a);
+    dropUse(code[i].b);
+}
+
+void Optimizer::visit(uint32_t i) {
+    Quad &q = code[i];
+
+    // 1) Constant folding & algebraic simplification (x + 0, x * 1,
+    //    x * 0, x / 1, etc.): the instruction becomes a copy
+    if (isBinary(q.op)) {
+        const Operand &a = q.a, &b = q.b;
+        Operand result;
+        bool simplified = true;
+        if (foldBinary(q.op, a, b, result)) {}
+        else if (q.op == Opcode::Add && b.isInt(0)) result = a;
+        else if (q.op == Opcode::Add && a.isInt(0)) result = b;
+        else if (q.op == Opcode::Sub && b.isInt(0)) result = a;
+        else if (q.op == Opcode::Mul && b.isInt(1)) result = a;
+        else if (q.op == Opcode::Mul && a.isInt(1)) result = b;
+        // x * 0 is 0 only for an integer x (a double gives 0.0, or NaN)
+        else if (q.op == Opcode::Mul && ((a.isInt(0) && !b.isDouble()) || (b.isInt(0) && !a.isDouble())))
+            result = Operand::integer(0);
+        else if (q.op == Opcode::Div && b.isInt(1)) result = a;
+        else simplified = false;
+
+        if (simplified) {
+            string before = remarks ? quoted(q) : string();
+            bool folded = result.isConst() && a.isConst() && b.isConst();
+            q.op = Opcode::Copy;
+            setOperand(i, 1, convertFor(q.dst, result));
+            setOperand(i, 2, Operand());
+            if (remarks)
+                remarks->add(before + " folded to " + quoted(q) +
+                             (folded ? " (constant operands)" : " (algebraic identity)"));
+        }
+    }
+
+    bool tempDef = definesTemp(q) && !multiDef[q.dst.id];
+    if (!tempDef) return;
+    uint32_t t = q.dst.id;
+
+    // 2) t = X (direct copy, nothing converted): every use of t reads X
+    //    instead
+    if (q.op == Opcode::Copy && q.a != q.dst && !convertsOnStore(q)) {
+        if (remarks) remarks->add(quoted(q) + " propagated into its uses");
+        Operand x = q.a;
+        for (int32_t u = firstUse[t]; u >= 0; u = uses[u].next) {
+            Use use = uses[u];
+            if (removed[use.instr] || slotOf(use.instr, use.slot) != q.dst) continue;
+            setOperand(use.instr, use.slot, x);
+            enqueue(use.instr);
+        }
+        remove(i);
+        return;
+    }
+
+    // 3) Never read: drop the definition (unless it may fault)
+    if (useCount[t] == 0 && !mayFault(q)) {
+        if (remarks) remarks->add(quoted(q) + " removed (result never used)");
+        remove(i);
+        return;
+    }
+
+    // 4) Single-use inlining: "t = a op b" followed by "v = t" becomes
+    //    "v = a op b" (nothing runs between them, so a and b are unchanged;
+    //    t must hold the result unconverted)
+    int32_t j = nextLive[i];
+    if (useCount[t] == 1 && !convertsOnStore(q) && j >= 0 && code[j].op == Opcode::Copy &&
+        code[j].dst.kind == OperandKind::Var && code[j].a == q.dst) {
+        Quad merged{q.op, code[j].dst, q.a, q.b};
+        if (remarks) remarks->add(quoted(q) + " inlined into " + quoted(code[j]) + " (single use)");
+        code[j] = merged;
+        useCount[t] = 0;
+        addUse(j, 1);
+        addUse(j, 2);
+        remove(i);
+        enqueue(j);
+    }
+}
+
+void Optimizer::run() {
+    size_t n = code.size();
+    removed.assign(n, 0);
+    queued.assign(n, 0);
+    prevLive.resize(n);
+    nextLive.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        prevLive[i] = (int32_t)i - 1;
+        nextLive[i] = (i + 1 < n) ? (int32_t)i + 1 : -1;
+    }
+
+    // Temporaries are numbered densely from 1, so tables are indexed by number
+    uint32_t maxTemp = 0;
+    for (const Quad &q : code)
+        for (const Operand *o : {&q.dst, &q.a, &q.b})
+            if (o->isTemp()) maxTemp = max(maxTemp, o->id);
+    def.assign(maxTemp + 1, -1);
+    multiDef.assign(maxTemp + 1, 0);
+    firstUse.assign(maxTemp + 1, -1);
+    useCount.assign(maxTemp + 1, 0);
+
+    // Def-use chains, built once
+    for (size_t i = 0; i < n; ++i) {
+        if (definesTemp(code[i])) {
+            uint32_t t = code[i].dst.id;
+            if (def[t] >= 0) multiDef[t] = 1;
+            def[t] = (int32_t)i;
+        }
+        addUse((uint32_t)i, 1);
+        addUse((uint32_t)i, 2);
+    }
+
+    // Visit everything once in program order, then whatever changed
+    for (size_t i = 0; i < n; ++i) enqueue((int32_t)i);
+    while (queueHead < queue.size()) {
+        uint32_t i = queue[queueHead++];
+        queued[i] = 0;
+        if (!removed[i]) visit(i);
+    }
+
+    // Rebuild code skipping removed instructions
+    vector<Quad> newCode;
+    newCode.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+        if (!removed[i]) newCode.push_back(code[i]);
+    code.swap(newCode);
+}
+
+// -----------------------------
+// Sparse conditional constant propagation
+// -----------------------------
+// Wegman & Zadeck over the SSA view: every value starts unknown (Top),
+// may become one constant and finally varying (Bottom); a block is only
+// evaluated once an edge into it is found executable, so constants flow
+// through variables and phis while branches that cannot be taken never
+// contribute.
+struct Cell {
+    enum State : uint8_t { Top, Const, Bottom } state = Top;
+    Operand value;
+};
+
+// Same constant, bit for bit (0.0 and -0.0 differ, NaN equals itself)
+bool sameConstant(const Operand &x, const Operand &y) {
+    if (x.kind != y.kind) return false;
+    if (x.kind == OperandKind::Float) return memcmp(&x.f, &y.f, sizeof x.f) == 0;
+    return x == y;
+}
+
+Cell meet(const Cell &x, const Cell &y) {
+    if (x.state == Cell::Top) return y;
+    if (y.state == Cell::Top) return x;
+    if (x.state == Cell::Const && y.state == Cell::Const && sameConstant(x.value, y.value)) return x;
+    return Cell{Cell::Bottom, {}};
+}
+
+class ConstantPropagator {
+public:
+    ConstantPropagator(vector<Quad> &c, RemarkSink *r) : code(c), remarks(r), ssa(c) {}
+    void run();
+
+private:
+    vector<Quad> &code;
+    RemarkSink *remarks;
+    SSAForm ssa;
+    vector<Cell> cell;                    // value -> lattice cell
+    vector<vector<uint32_t>> users;       // value -> instructions / phis reading it
+    vector<pair<uint32_t, uint32_t>> phiAt;   // user id - code.size() -> (block, phi)
+    vector<vector<char>> edgeLive;        // block -> executable in-edges, in preds order
+    vector<char> blockLive;
+    vector<pair<uint32_t, uint32_t>> flowWork;   // edges that became executable
+    vector<uint32_t> valueWork;                  // values whose cell changed
+
+    Cell operandCell(uint32_t i, int slot) const;
+    void setCell(uint32_t value, const Cell &c);
+    void markEdge(uint32_t from, int32_t to);
+    void visitPhi(uint32_t b, const Phi &phi);
+    void visitInstr(uint32_t i);
+    void visitBlock(uint32_t b);
+    void rewrite();
+};
+
+Cell ConstantPropagator::operandCell(uint32_t i, int slot) const {
+    const Operand &o = slot == 1 ? code[i].a : code[i].b;
+    if (o.isConst()) return Cell{Cell::Const, o};
+    uint32_t v = ssa.useValue(i, slot);
+    return v == NO_VALUE ? Cell{Cell::Bottom, {}} : cell[v];
+}
+
+void ConstantPropagator::setCell(uint32_t value, const Cell &c) {
+    Cell next = meet(cell[value], c);    // cells only move down
+    if (next.state == cell[value].state) return;
+    cell[value] = next;
+    valueWork.push_back(value);
+}
+
+void ConstantPropagator::markEdge(uint32_t from, int32_t to) {
+    if (to < 0) return;
+    const vector<uint32_t> &preds = ssa.cfg.blocks[to].preds;
+    for (size_t k = 0; k < preds.size(); ++k) {
+        if (preds[k] != from || edgeLive[to][k]) continue;
+        edgeLive[to][k] = 1;
+        flowWork.push_back({from, (uint32_t)to});
+    }
+}
+
+void ConstantPropagator::visitPhi(uint32_t b, const Phi &phi) {
+    Cell c;
+    for (size_t k = 0; k < phi.args.size(); ++k) {
+        if (!edgeLive[b][k]) continue;
+        c = meet(c, phi.args[k] == NO_VALUE ? Cell{Cell::Bottom, {}} : cell[phi.args[k]]);
+    }
+    setCell(phi.value, c);
+}
+
+void ConstantPropagator::visitInstr(uint32_t i) {
+    const Quad &q = code[i];
+    uint32_t b = ssa.cfg.blockOf[i];
+
+    if (assignsValue(q) && ssa.defValue[i] != NO_VALUE) {
+        Cell c;
+        if (q.op == Opcode::Copy) {
+            c = operandCell(i, 1);
+        } else {
+            Cell x = operandCell(i, 1), y = operandCell(i, 2);
+            if (x.state == Cell::Const && y.state == Cell::Const) {
+                c.state = foldBinary(q.op, x.value, y.value, c.value) ? Cell::Const : Cell::Bottom;
+            } else if (x.state == Cell::Bottom || y.state == Cell::Bottom) {
+                c.state = Cell::Bottom;
+            }
+        }
+        // the value stored, in the destination's type
+        if (c.state == Cell::Const) c.value = convertFor(q.dst, c.value);
+        setCell(ssa.defValue[i], c);
+    }
+
+    // Successor edges are decided by the block's last instruction
+    if (i + 1 != ssa.cfg.blocks[b].last) return;
+    if (q.op == Opcode::Goto) {
+        markEdge(b, ssa.cfg.labelTarget(q.a));
+    } else if (isCondJump(q.op)) {
+        Cell c = operandCell(i, 1);
+        if (c.state == Cell::Top) return;
+        bool known = c.state == Cell::Const;
+        bool taken = known && jumpTaken(q, c.value);
+        if (!known || taken) markEdge(b, ssa.cfg.labelTarget(q.b));
+        if ((!known || !taken) && b + 1 < ssa.cfg.size()) markEdge(b, (int32_t)b + 1);
+    } else if (q.op != Opcode::Return && b + 1 < ssa.cfg.size()) {
+        markEdge(b, (int32_t)b + 1);
+    }
+}
+
+void ConstantPropagator::visitBlock(uint32_t b) {
+    for (const Phi &phi : ssa.phis[b]) visitPhi(b, phi);
+    for (uint32_t i = ssa.cfg.blocks[b].first; i < ssa.cfg.blocks[b].last; ++i) visitInstr(i);
+}
+
+void ConstantPropagator::run() {
+    if (ssa.cfg.size() == 0) return;
+    uint32_t n = (uint32_t)code.size();
+
+    // Entry values are unknown inputs; everything else starts at Top
+    cell.assign(ssa.values.size(), Cell{});
+    for (uint32_t v = 0; v < ssa.vars.size(); ++v) cell[v].state = Cell::Bottom;
+
+    users.assign(ssa.values.size(), {});
+    for (uint32_t i = 0; i < n; ++i)
+        for (uint32_t v : {ssa.useA[i], ssa.useB[i]})
+            if (v != NO_VALUE && (users[v].empty() || users[v].back() != i)) users[v].push_back(i);
+    for (uint32_t b = 0; b < ssa.cfg.size(); ++b) {
+        for (uint32_t k = 0; k < ssa.phis[b].size(); ++k) {
+            uint32_t id = n + (uint32_t)phiAt.size();
+            phiAt.push_back({b, k});
+            for (uint32_t v : ssa.phis[b][k].args)
+                if (v != NO_VALUE && (users[v].empty() || users[v].back() != id)) users[v].push_back(id);
+        }
+    }
+
+    edgeLive.resize(ssa.cfg.size());
+    for (uint32_t b = 0; b < ssa.cfg.size(); ++b) edgeLive[b].assign(ssa.cfg.blocks[b].preds.size(), 0);
+    blockLive.assign(ssa.cfg.size(), 0);
+
+    blockLive[0] = 1;
+    visitBlock(0);
+    while (!flowWork.empty() || !valueWork.empty()) {
+        if (!flowWork.empty()) {
+            uint32_t to = flowWork.back().second;
+            flowWork.pop_back();
+            if (!blockLive[to]) {
+                blockLive[to] = 1;
+                visitBlock(to);
+            } else {
+                for (const Phi &phi : ssa.phis[to]) visitPhi(to, phi);
+            }
+            continue;
+        }
+        uint32_t v = valueWork.back();
+        valueWork.pop_back();
+        for (uint32_t u : users[v]) {
+            if (u < n) {
+                if (blockLive[ssa.cfg.blockOf[u]]) visitInstr(u);
+            } else {
+                auto [b, k] = phiAt[u - n];
+                if (blockLive[b]) visitPhi(b, ssa.phis[b][k]);
+            }
+        }
+    }
+    rewrite();
+}
+
+// Constants replace the reads and results they were proven for, decided
+// branches become gotos (or vanish), and blocks never reached are dropped
+void ConstantPropagator::rewrite() {
+    vector<Quad> out;
+    out.reserve(code.size());
+    size_t unreachable = 0;
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        if (!blockLive[ssa.cfg.blockOf[i]]) {
+            unreachable++;
+            continue;
+        }
+        Quad q = code[i];
+        if (q.op != Opcode::Label && q.op != Opcode::Goto) {
+            for (int slot = 1; slot <= 2; ++slot) {
+                uint32_t v = ssa.useValue(i, slot);
+                if (v != NO_VALUE && cell[v].state == Cell::Const) (slot == 1 ? q.a : q.b) = cell[v].value;
+            }
+        }
+        if (assignsValue(q) && ssa.defValue[i] != NO_VALUE && cell[ssa.defValue[i]].state == Cell::Const) {
+            q.op = Opcode::Copy;
+            q.a = cell[ssa.defValue[i]].value;
+            q.b = Operand();
+        }
+        if (isCondJump(q.op) && q.a.isConst()) {
+            bool taken = jumpTaken(q, q.a);
+            if (remarks)
+                remarks->add(quoted(code[i]) + (taken ? " always jumps: now a goto" : " never jumps: removed"));
+            if (!taken) continue;
+            q = Quad{Opcode::Goto, Operand(), q.b, Operand()};
+        } else if (remarks && formatQuad(q) != formatQuad(code[i])) {
+            remarks->add(quoted(code[i]) + " became " + quoted(q) + " (constant on every path)");
+        }
+        out.push_back(q);
+    }
+    if (remarks && unreachable)
+        remarks->add(to_string(unreachable) + " instruction(s) in blocks that never run removed");
+    code.swap(out);
+}
+
+void propagateConstants(vector<Quad> &code, RemarkSink *remarks) {
+    ConstantPropagator(code, remarks).run();
+}
+
+// -----------------------------
+// Global value numbering
+// -----------------------------
+// Walks the dominator tree of the SSA view giving every value a number:
+// copies take their source's number, a phi whose arguments agree takes
+// theirs, and "a op b" is looked up by (op, number of a, number of b) with
+// the operands of commutative operators ordered and > / >= turned into
+// < / <=. A computation already done by a dominating instruction becomes
+// a copy of the variable holding it, provided that variable was not
+// reassigned in between. Like the symbol table, the expression table is
+// scoped: what a block adds is undone when its subtree is done.
+struct ExprKey {
+    Opcode op;
+    uint32_t x, y;      // operand value numbers
+    bool operator==(const ExprKey &o) const { return op == o.op && x == o.x && y == o.y; }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey &k) const {
+        uint64_t h = ((uint64_t)k.x << 32 | k.y) * 0x9E3779B97F4A7C15ull;
+        return (size_t)(h ^ (h >> 29) ^ (uint64_t)k.op);
+    }
+};
+
+class ValueNumbering {
+public:
+    // Phis are needed even where a variable is dead: reusing it as a
+    // holder adds reads the liveness-pruned form did not account for
+    ValueNumbering(vector<Quad> &c, RemarkSink *r) : code(c), remarks(r), ssa(c, false) {}
+    void run();
+
+private:
+    static constexpr uint32_t UNNUMBERED = UINT32_MAX;
+
+    struct Available {
+        uint32_t number;
+        uint32_t holder;    // SSA value that computed it
+    };
+    struct UndoEntry {
+        ExprKey key;
+        bool existed;
+        Available old;
+    };
+
+    vector<Quad> &code;
+    RemarkSink *remarks;
+    SSAForm ssa;
+    vector<uint32_t> number;                      // SSA value -> value number
+    uint32_t nextNumber = 0;
+    unordered_map<uint64_t, uint32_t> intNumber, floatNumber;   // constants
+    unordered_map<ExprKey, Available, ExprKeyHash> table;
+    vector<UndoEntry> undo;
+    vector<vector<uint32_t>> current;             // variable -> stack of its values
+    vector<uint32_t> pushed;                      // variables whose stack grew
+
+    uint32_t numberOf(uint32_t i, int slot);
+    void define(uint32_t value, uint32_t n);
+    void numberBlock(uint32_t b);
+};
+
+uint32_t ValueNumbering::numberOf(uint32_t i, int slot) {
+    const Operand &o = slot == 1 ? code[i].a : code[i].b;
+    if (o.kind == OperandKind::Int || o.kind == OperandKind::Float) {
+        uint64_t bits;
+        memcpy(&bits, &o.i, sizeof bits);
+        auto &pool = o.kind == OperandKind::Int ? intNumber : floatNumber;
+        auto [it, fresh] = pool.emplace(bits, nextNumber);
+        if (fresh) ++nextNumber;
+        return it->second;
+    }
+    uint32_t v = ssa.useValue(i, slot);
+    if (v == NO_VALUE) return nextNumber++;
+    if (number[v] == UNNUMBERED) number[v] = nextNumber++;
+    return number[v];
+}
+
+void ValueNumbering::define(uint32_t value, uint32_t n) {
+    number[value] = n;
+    uint32_t var = ssa.values[value].var;
+    current[var].push_back(value);
+    pushed.push_back(var);
+}
+
+void ValueNumbering::numberBlock(uint32_t b) {
+    const BasicBlock &bb = ssa.cfg.blocks[b];
+    for (const Phi &phi : ssa.phis[b]) {
+        uint32_t n = UNNUMBERED;
+        for (size_t k = 0; k < phi.args.size(); ++k) {
+            uint32_t a = phi.args[k];
+            if (a == NO_VALUE) continue;      // edge from an unreachable block
+            uint32_t an = number[a];
+            if (an == UNNUMBERED || (n != UNNUMBERED && an != n)) {
+                n = UNNUMBERED;
+                break;
+            }
+            n = an;
+        }
+        define(phi.value, n == UNNUMBERED ? nextNumber++ : n);
+    }
+
+    for (uint32_t i = bb.first; i < bb.last; ++i) {
+        uint32_t value = ssa.defValue[i];
+        if (value == NO_VALUE) continue;
+        Quad &q = code[i];
+        // a value converted on the way in is not the one computed
+        bool exact = !convertsOnStore(q);
+        if (q.op == Opcode::Copy) {
+            define(value, exact ? numberOf(i, 1) : nextNumber++);
+            continue;
+        }
+
+        ExprKey key{q.op, numberOf(i, 1), numberOf(i, 2)};
+        switch (key.op) {
+            case Opcode::Gt: key.op = Opcode::Lt; swap(key.x, key.y); break;
+            case Opcode::Ge: key.op = Opcode::Le; swap(key.x, key.y); break;
+            case Opcode::Add: case Opcode::Mul: case Opcode::Eq: case Opcode::Ne:
+                if (key.x > key.y) swap(key.x, key.y);
+                break;
+            default: break;
+        }
+
+        auto it = table.find(key);
+        if (it != table.end()) {
+            const SSAValue &h = ssa.values[it->second.holder];
+            if (current[h.var].back() == it->second.holder) {
+                Quad reuse{Opcode::Copy, q.dst, code[h.instr].dst, Operand()};
+                if (remarks)
+                    remarks->add(quoted(q) + " recomputes " + formatOperand(reuse.a) + ": now " + quoted(reuse));
+                q = reuse;
+                define(value, exact ? it->second.number : nextNumber++);
+                continue;
+            }
+            if (exact) {
+                // the holder was overwritten: this instruction holds it from now on
+                undo.push_back({key, true, it->second});
+                it->second.holder = value;
+                define(value, it->second.number);
+                continue;
+            }
+        }
+        if (!exact) {
+            define(value, nextNumber++);
+            continue;
+        }
+        undo.push_back({key, false, {}});
+        table.emplace(key, Available{nextNumber, value});
+        define(value, nextNumber++);
+    }
+}
+
+void ValueNumbering::run() {
+    size_t nb = ssa.cfg.size();
+    if (nb == 0) return;
+    number.assign(ssa.values.size(), UNNUMBERED);
+    current.assign(ssa.vars.size(), {});
+    for (uint32_t v = 0; v < ssa.vars.size(); ++v) {
+        current[v].push_back(v);
+        number[v] = nextNumber++;
+    }
+
+    vector<vector<uint32_t>> children(nb);
+    for (uint32_t b = 1; b < nb; ++b)
+        if (ssa.idom[b] >= 0) children[ssa.idom[b]].push_back(b);
+
+    // (block, next child, undo / pushed sizes on entry)
+    struct Frame { uint32_t block; size_t child, undoMark, pushMark; };
+    vector<Frame> stack;
+    auto enter = [&](uint32_t b) {
+        stack.push_back({b, 0, undo.size(), pushed.size()});
+        numberBlock(b);
+    };
+    enter(0);
+    while (!stack.empty()) {
+        Frame &f = stack.back();
+        if (f.child < children[f.block].size()) {
+            enter(children[f.block][f.child++]);
+            continue;
+        }
+        while (undo.size() > f.undoMark) {
+            UndoEntry &u = undo.back();
+            if (u.existed) table[u.key] = u.old;
+            else table.erase(u.key);
+            undo.pop_back();
+        }
+        while (pushed.size() > f.pushMark) {
+            current[pushed.back()].pop_back();
+            pushed.pop_back();
+        }
+        stack.pop_back();
+    }
+
+    // Reusing a variable's own value leaves "x = x" behind
+    size_t kept = 0;
+    for (size_t i = 0; i < code.size(); ++i)
+        if (!(code[i].op == Opcode::Copy && code[i].a == code[i].dst)) code[kept++] = code[i];
+    code.resize(kept);
+}
+
+void numberValues(vector<Quad> &code, RemarkSink *remarks) {
+    ValueNumbering(code, remarks).run();
+}
+
+// -----------------------------
+// Redundancy across joins
+// -----------------------------
+// GVN reuses a computation only where one dominates the repeat. After
+// "if (c) { x = a * b; } else { x = a * b; }" neither arm dominates
+// "y = a * b", yet every path has just left the value in x:
+// - available expressions pick the candidates (a * b computed on every
+//   path into the block)
+// - a backward walk from the candidate finds the last computation on
+//   each path, with no write of a or b after it; all of them must store
+//   into the same variable w
+// - reaching definitions then show that every definition of w reaching
+//   the candidate is one of those computations, so w still holds the
+//   value and the candidate becomes "y = w"
+void reuseAvailable(vector<Quad> &code, RemarkSink *remarks) {
+    CFG cfg(code);
+    vector<uint32_t> exprs, exprOf;
+    DataflowResult avail = availableExpressions(code, cfg, exprs, &exprOf);
+
+    vector<uint32_t> candidates;
+    for (uint32_t b = 0; b < cfg.size(); ++b)
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].last; ++i)
+            if (exprOf[i] != UINT32_MAX && avail.in[b].test(exprOf[i])) candidates.push_back(i);
+    if (candidates.empty()) return;
+
+    // Walks back from s; false if some path has no computation, writes
+    // a or b after it, or stores it somewhere other than w
+    vector<uint32_t> scanned(cfg.size(), UINT32_MAX);   // block -> candidate that scanned it
+    auto holderBefore = [&](uint32_t s, Operand &w) {
+        const Quad &q = code[s];
+        bool found = false;
+        vector<pair<uint32_t, uint32_t>> work{{cfg.blockOf[s], s}};   // (block, scan from here down)
+        while (!work.empty()) {
+            auto [b, end] = work.back();
+            work.pop_back();
+            bool computed = false;
+            for (uint32_t i = end; i-- > cfg.blocks[b].first;) {
+                const Quad &r = code[i];
+                if (assignsValue(r) && (r.dst == q.a || r.dst == q.b)) return false;
+                if (exprOf[i] != exprOf[s]) continue;
+                if (convertsOnStore(r) || (found && r.dst != w)) return false;
+                w = r.dst;
+                found = computed = true;
+                break;
+            }
+            if (computed) continue;
+            if (cfg.blocks[b].preds.empty()) return false;   // the entry (or unreachable code)
+            for (uint32_t p : cfg.blocks[b].preds) {
+                if (scanned[p] == s) continue;
+                scanned[p] = s;
+                work.push_back({p, cfg.blocks[p].last});
+            }
+        }
+        return found;
+    };
+
+    // Reaching definitions are needed only for the holder variables
+    vector<pair<uint32_t, Operand>> holders;
+    vector<Operand> holderVars;
+    for (uint32_t s : candidates) {
+        Operand w;
+        if (!holderBefore(s, w)) continue;
+        holders.push_back({s, w});
+        holderVars.push_back(w);
+    }
+    if (holders.empty()) return;
+    vector<uint32_t> defs;
+    DataflowResult reaching = reachingDefinitions(code, cfg, defs, &holderVars);
+
+    // Is every definition of w that reaches s a computation of s's expression?
+    auto holds = [&](uint32_t s, const Operand &w) {
+        uint32_t b = cfg.blockOf[s];
+        for (uint32_t i = s; i-- > cfg.blocks[b].first;)
+            if (assignsValue(code[i]) && code[i].dst == w) return exprOf[i] == exprOf[s];
+        bool all = true;
+        reaching.in[b].forEach([&](size_t d) {
+            const Quad &r = code[defs[d]];
+            if (r.dst == w && exprOf[defs[d]] != exprOf[s]) all = false;
+        });
+        return all;
+    };
+
+    // The analyses describe the code as it was: rewritten computations
+    // keep their value, so each candidate is decided on the original
+    vector<char> dead(code.size(), 0);
+    for (auto &[s, w] : holders) {
+        if (!holds(s, w)) continue;
+        Quad &q = code[s];
+        string before = remarks ? quoted(q) : string();
+        if (q.dst == w) {
+            dead[s] = 1;
+            if (remarks) remarks->add(before + " removed (" + formatOperand(w) + " already holds it on every path)");
+            continue;
+        }
+        q = Quad{Opcode::Copy, q.dst, w, Operand()};
+        if (remarks) remarks->add(before + " recomputes " + formatOperand(w) + " (every path): now " + quoted(q));
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < code.size(); ++i)
+        if (!dead[i]) code[kept++] = code[i];
+    code.resize(kept);
+}
+
+// -----------------------------
+// Control-flow simplification
+// -----------------------------
+// Cleans up what the if-lowering leaves behind, repeating until nothing
+// changes:
+// - constant conditions become a goto or disappear
+// - jumps to a goto are threaded to its final target, and a goto to a
+//   return becomes that return
+// - "if c goto L1; goto L2; L1:" becomes "ifFalse c goto L2; L1:"
+// - blocks the entry cannot reach (dead arms, code after a return) go
+// - jumps to the next instruction and labels no one jumps to go, which
+//   merges straight-line blocks
+void simplifyControlFlow(vector<Quad> &code, RemarkSink *remarks) {
+    vector<char> dead;
+    auto compact = [&]() {
+        size_t kept = 0;
+        for (size_t i = 0; i < code.size(); ++i)
+            if (!dead[i]) code[kept++] = code[i];
+        bool removed = kept != code.size();
+        code.resize(kept);
+        return removed;
+    };
+
+    bool changed = true;
+    while (changed && !code.empty()) {
+        changed = false;
+        size_t n = code.size();
+        dead.assign(n, 0);
+
+        vector<int32_t> labelAt;      // label number -> its position
+        for (size_t i = 0; i < n; ++i) {
+            if (code[i].op != Opcode::Label) continue;
+            if (code[i].a.id >= labelAt.size()) labelAt.resize(code[i].a.id + 1, -1);
+            labelAt[code[i].a.id] = (int32_t)i;
+        }
+        auto position = [&](const Operand &label) {
+            return label.id < labelAt.size() ? labelAt[label.id] : -1;
+        };
+        // first instruction at or after p that is not a label
+        auto skipLabels = [&](size_t p) {
+            while (p < n && code[p].op == Opcode::Label) ++p;
+            return p;
+        };
+        // where a jump to `label` really ends up (gotos followed, cycles stop)
+        auto thread = [&](Operand label) {
+            for (size_t hops = 0; hops < n; ++hops) {
+                int32_t p = position(label);
+                size_t s = p < 0 ? n : skipLabels((size_t)p);
+                if (s >= n || code[s].op != Opcode::Goto || code[s].a == label) break;
+                label = code[s].a;
+            }
+            return label;
+        };
+
+        for (size_t i = 0; i < n; ++i) {
+            if (dead[i]) continue;
+            Quad &q = code[i];
+            if (isCondJump(q.op) && q.a.isConst()) {
+                bool taken = jumpTaken(q, q.a);
+                if (remarks)
+                    remarks->add(quoted(q) + (taken ? " always jumps: now a goto" : " never jumps: removed"));
+                if (!taken) {
+                    dead[i] = 1;
+                    changed = true;
+                    continue;
+                }
+                q = Quad{Opcode::Goto, Operand(), q.b, Operand()};
+                changed = true;
+            }
+
+            Operand &target = (q.op == Opcode::Goto) ? q.a : q.b;
+            if (q.op == Opcode::Goto || isCondJump(q.op)) {
+                Operand to = thread(target);
+                if (to != target) {
+                    if (remarks) remarks->add(quoted(q) + " threaded to " + formatOperand(to) + " (jump to a goto)");
+                    target = to;
+                    changed = true;
+                }
+            }
+            if (q.op == Opcode::Goto) {
+                int32_t p = position(q.a);
+                size_t s = p < 0 ? n : skipLabels((size_t)p);
+                if (s < n && code[s].op == Opcode::Return) {
+                    if (remarks) remarks->add(quoted(q) + " replaced by " + quoted(code[s]) + " (jump to a return)");
+                    q = code[s];
+                    changed = true;
+                }
+            } else if (isCondJump(q.op) && i + 1 < n && code[i + 1].op == Opcode::Goto) {
+                int32_t p = position(q.b);
+                if (p > (int32_t)i + 1 && skipLabels(i + 2) > (size_t)p) {
+                    Quad inverted{q.op == Opcode::IfGoto ? Opcode::IfFalseGoto : Opcode::IfGoto,
+                                  Operand(), q.a, code[i + 1].a};
+                    if (remarks)
+                        remarks->add(quoted(q) + " and " + quoted(code[i + 1]) + " became " +
+                                     quoted(inverted) + " (branch over a goto)");
+                    q = inverted;
+                    dead[i + 1] = 1;
+                    changed = true;
+                }
+            }
+        }
+        compact();
+
+        // Unreachable blocks
+        CFG cfg(code);
+        vector<char> reached(cfg.size(), 0);
+        for (uint32_t b : cfg.reversePostOrder()) reached[b] = 1;
+        dead.assign(code.size(), 0);
+        size_t unreachable = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            dead[i] = !reached[cfg.blockOf[i]];
+            unreachable += dead[i];
+        }
+        if (remarks && unreachable)
+            remarks->add(to_string(unreachable) + " unreachable instruction(s) removed");
+        changed |= compact();
+
+        // Jumps over nothing but labels, then labels no jump names
+        n = code.size();
+        labelAt.assign(labelAt.size(), -1);
+        for (size_t i = 0; i < n; ++i)
+            if (code[i].op == Opcode::Label) labelAt[code[i].a.id] = (int32_t)i;
+        dead.assign(n, 0);
+        vector<char> referenced(labelAt.size(), 0);
+        for (size_t i = 0; i < n; ++i) {
+            const Quad &q = code[i];
+            if (q.op != Opcode::Goto && !isCondJump(q.op)) continue;
+            const Operand &target = (q.op == Opcode::Goto) ? q.a : q.b;
+            int32_t p = position(target);
+            if (p > (int32_t)i && skipLabels(i + 1) > (size_t)p) {
+                if (remarks) remarks->add(quoted(q) + " removed (jumps to the next instruction)");
+                dead[i] = 1;
+            } else if (target.id < referenced.size()) referenced[target.id] = 1;
+        }
+        for (size_t i = 0; i < n; ++i)
+            if (code[i].op == Opcode::Label && !referenced[code[i].a.id]) dead[i] = 1;
+        changed |= compact();
+    }
+}
+
+// Global dead-store elimination: drop assignments to variables and temps
+// that no path reads before they are overwritten or the function returns
+// (a division that may fault stays).
+// Removing a store can kill the values it read, so repeat until stable.
+void eliminateDeadStores(vector<Quad> &code, RemarkSink *remarks) {
+    bool changed = true;
+    while (changed && !code.empty()) {
+        changed = false;
+        CFG cfg(code);
+        OperandIndex vars(code);
+        DataflowResult live = liveVariables(code, cfg, vars);
+
+        vector<char> dead(code.size(), 0);
+        for (uint32_t b = 0; b < cfg.size(); ++b) {
+            BitVector now = live.out[b];
+            for (uint32_t i = cfg.blocks[b].last; i-- > cfg.blocks[b].first;) {
+                const Quad &q = code[i];
+                if (assignsValue(q)) {
+                    int32_t d = vars.of(q.dst);
+                    if (d >= 0 && !now.test(d) && !mayFault(q)) {
+                        if (remarks) remarks->add(quoted(q) + " removed (" + formatOperand(q.dst) + " is not read afterwards)");
+                        dead[i] = 1;
+                        changed = true;
+                        continue;
+                    }
+                    if (d >= 0) now.reset(d);
+                }
+                for (const Operand *o : {&q.a, &q.b}) {
+                    int32_t v = vars.of(*o);
+                    if (v >= 0) now.set(v);
+                }
+            }
+        }
+
+        if (!changed) break;
+        size_t kept = 0;
+        for (size_t i = 0; i < code.size(); ++i)
+            if (!dead[i]) code[kept++] = code[i];
+        code.resize(kept);
+    }
+}
+
+// -----------------------------
+// Pass manager
+// -----------------------------
+void runFold(vector<Quad> &code, RemarkSink *remarks) { Optimizer(code, remarks).run(); }
+
+struct PassInfo {
+    const char *name;
+    void (*run)(vector<Quad> &, RemarkSink *);
+};
+
+const PassInfo passTable[] = {
+    {"fold", runFold},
+    {"sccp", propagateConstants},
+    {"gvn", numberValues},
+    {"cse", reuseAvailable},
+    {"simplifycfg", simplifyControlFlow},
+    {"dce", eliminateDeadStores},
+};
+constexpr int FOLD = 0, SCCP = 1, GVN = 2, CSE = 3, SIMPLIFYCFG = 4, DCE = 5;
+
+int findPass(const string &name) {
+    for (int p = 0; p < (int)(sizeof passTable / sizeof passTable[0]); ++p)
+        if (name == passTable[p].name) return p;
+    return -1;
+}
+
+// Fingerprint of an instruction for the removed / added counts
+size_t quadHash(const Quad &q) {
+    return hash<string>()(formatQuad(q));
+}
+
+} // namespace
+
+string availablePasses() {
+    string names;
+    for (const PassInfo &p : passTable) names += string(names.empty() ? "" : ",") + p.name;
+    return names;
+}
+
+bool PassManager::configure(const OptOptions &opts, string &error) {
+    options = opts;
+    order.clear();
+    if (!options.passes.empty()) {
+        for (const string &name : options.passes) {
+            int p = findPass(name);
+            if (p < 0) {
+                error = "unknown pass '" + name + "' (available: " + availablePasses() + ")";
+                return false;
+            }
+            order.push_back(p);
+        }
+    } else if (options.level == 1) {
+        order = {FOLD, SIMPLIFYCFG, DCE};
+    } else if (options.level >= 2) {
+        order = {FOLD, SCCP, GVN, CSE, FOLD, SIMPLIFYCFG, DCE};
+    }
+
+    for (const string &name : options.disabled) {
+        int p = findPass(name);
+        if (p < 0) {
+            error = "unknown pass '" + name + "' (available: " + availablePasses() + ")";
+            return false;
+        }
+        vector<int> kept;
+        for (int q : order)
+            if (q != p) kept.push_back(q);
+        order.swap(kept);
+    }
+    return true;
+}
+
+string PassManager::pipeline() const {
+    string text;
+    for (int p : order) text += string(text.empty() ? "" : ",") + passTable[p].name;
+    return text;
+}
+
+void PassManager::run(vector<Quad> &code) {
+    // -O3 (with the level's pipeline) repeats it until a round leaves the
+    // code unchanged, at most MAX_ROUNDS times
+    int rounds = (options.level >= 3 && options.passes.empty()) ? MAX_ROUNDS : 1;
+    auto fingerprint = [&]() {
+        size_t h = code.size();
+        for (const Quad &q : code) h = h * 31 + quadHash(q);
+        return h;
+    };
+    for (int round = 0; round < rounds; ++round) {
+        size_t start = rounds > 1 ? fingerprint() : 0;
+
+        for (int p : order) {
+            if (code.empty()) break;
+            RemarkSink sink{passTable[p].name, passRemarks};
+            RemarkSink *remarks = options.remarks ? &sink : nullptr;
+            if (!options.timePasses) {
+                passTable[p].run(code, remarks);
+                continue;
+            }
+
+            unordered_map<size_t, int> before;
+            for (const Quad &q : code) before[quadHash(q)]++;
+            size_t countBefore = code.size();
+
+            auto t0 = chrono::steady_clock::now();
+            passTable[p].run(code, remarks);
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+            size_t added = 0;
+            for (const Quad &q : code) {
+                auto it = before.find(quadHash(q));
+                if (it != before.end() && it->second > 0) it->second--;
+                else added++;
+            }
+            size_t removed = countBefore + added - code.size();
+            passStats.push_back({passTable[p].name, ms, countBefore, code.size(), removed, added});
+        }
+
+        if (rounds > 1 && fingerprint() == start) return;
+    }
+    if (rounds > 1 && options.remarks)
+        passRemarks.push_back({"pipeline", "stopped after " + to_string(rounds) +
+                                               " rounds with the code still changing"});
+}
+
+void optimizeTAC(vector<Quad> &code) {
+    PassManager pm;
+    string error;
+    pm.configure(OptOptions(), error);
+    pm.run(code);
+}
+
+void optimizeFragment(vector<Quad> &code) {
+    OptOptions options;
+    options.disabled = {"dce"};
+    PassManager pm;
+    string error;
+    pm.configure(options, error);
+    pm.run(code);
+}
@@ -1,13 +1,94 @@
-#ifndef OPT_H
-#define OPT_H
-
-#include <string>
-#include <vector>
-
-// Performs optimization passes on the generated TAC
-// - Multi-pass constant folding & propagation
-// - Algebraic simplifications (x+0, x*1, x*0, x/1, etc.)
-// - Temporary elimination & single-use inlining
-void optimizeTAC(std::vector<std::string> &code);
-
-#endif // OPT_H
+#ifndef OPT_H
+#define OPT_H
+
+#include <string>
+#include <vector>
+#include "tac.h"
+
+// TAC optimization passes, run in order by a PassManager:
+//   fold         worklist over def-use chains (near-linear): constant
+//                folding, algebraic simplification (x+0, x*1, x/1, x*0
+//                for integer x, ...), copy propagation, unused temps,
+//                single-use inlining
+//   sccp         sparse conditional constant propagation on SSA form:
+//                constants flow through variables and merges, and
+//                branches that cannot run are removed
+//   gvn          global value numbering: repeated computations (a*b, b*a,
+//                x > y and y < x, ...) reuse the variable holding the value
+//   cse          a computation every path has already stored into the
+//                same variable reuses it where none dominates (after an
+//                if/else), from available expressions and reaching
+//                definitions
+//   simplifycfg  constant branches, unreachable code, jumps to the next
+//                instruction and goto chains are removed or threaded
+//   dce          dead-store elimination across blocks, from live-variable
+//                analysis
+// An unread result is only dropped if computing it cannot fault: an
+// integer division that may divide by zero stays (mayFault in tac.h), so
+// optimized code traps wherever the unoptimized code does.
+//
+// Pipelines per level:
+//   -O0  nothing
+//   -O1  fold, simplifycfg, dce
+//   -O2  fold, sccp, gvn, cse, fold, simplifycfg, dce   (default)
+//   -O3  the -O2 pipeline, repeated until a round changes nothing; a
+//        safety bound of MAX_ROUNDS rounds stops it (with a remark)
+//        should passes ever keep undoing each other
+
+struct OptOptions {
+    int level = 2;                        // 0..3
+    std::vector<std::string> passes;      // --passes=a,b: replaces the level's pipeline
+    std::vector<std::string> disabled;    // --disable=a,b: dropped from the pipeline
+    bool timePasses = false;              // collect PassStats
+    bool remarks = false;                 // collect OptRemarks
+};
+
+// What one pass run did (only collected with timePasses)
+struct PassStats {
+    const char *pass;
+    double millis;
+    size_t before, after;                 // instruction counts
+    size_t removed, added;                // instructions that disappeared / appeared
+};
+
+// "which instruction was changed and why" (only collected with remarks)
+struct OptRemark {
+    const char *pass;
+    std::string message;
+};
+
+class PassManager {
+public:
+    // -O3 rounds at most; a round only repeats after it changed the code,
+    // and real programs settle within a few
+    static constexpr int MAX_ROUNDS = 16;
+
+    // False, with a message in `error`, if a pass name is unknown
+    bool configure(const OptOptions &options, std::string &error);
+    void run(std::vector<Quad> &code);
+
+    const std::vector<PassStats> &stats() const { return passStats; }
+    const std::vector<OptRemark> &remarks() const { return passRemarks; }
+    // The passes that will run, e.g. "fold,sccp,gvn,cse,fold,simplifycfg,dce"
+    std::string pipeline() const;
+
+private:
+    OptOptions options;
+    std::vector<int> order;               // indices into the pass table
+    std::vector<PassStats> passStats;
+    std::vector<OptRemark> passRemarks;
+};
+
+// Names of all passes, comma-separated (for usage messages)
+std::string availablePasses();
+
+// The default (-O2) pipeline, without stats or remarks
+void optimizeTAC(std::vector<Quad> &code);
+
+// The same for a piece of a program that falls through into more code
+// (--watch compiles main one top-level statement at a time): dce is left
+// out, as the variables the piece stores may be read after it. The other
+// passes take a variable's value on entry as unknown.
+void optimizeFragment(std::vector<Quad> &code);
+
+#endif // OPT_H
@@ -1,253 +1,422 @@
-#include "parser.h"
-using namespace std;
-
-// --------------------- Parser constructor ---------------------
-Parser::Parser(const vector<Token> &toks) : tokens(toks), pos(0) {}
-
-// --------------------- Utility methods ---------------------
-Token Parser::peek() {
-    if (pos < tokens.size()) return tokens[pos];
-    return {"EOF", ""};
-}
-
-Token Parser::advance() {
-    if (pos < tokens.size()) return tokens[pos++];
-    return {"EOF", ""};
-}
-
-bool Parser::match(const string &type, const string &value) {
-    if (pos < tokens.size() && tokens[pos].type == type &&
-        (value.empty() || tokens[pos].value == value)) {
-        pos++;
-        return true;
-    }
-    return false;
-}
-
-bool Parser::isAtEnd() {
-    return pos >= tokens.size();
-}
-
-void Parser::error(const string &msg) {
-    cout << "Syntax Error: " << msg << "\n";
-    setErrorFlag();
-}
-
-// Expect a specific token or flag an error
-void Parser::expect(const string &type, const string &value) {
-    if (!match(type, value)) {
-        string got = isAtEnd() ? "end-of-file" : "'" + tokens[pos].value + "'";
-        error("expected '" + (value.empty() ? type : value) + "' but got " + got);
-    }
-}
-
-// --------------------- Grammar Implementation ---------------------
-shared_ptr<ASTNode> Parser::parse() {
-    auto program = parseProgram();
-    return program;
-}
-
-shared_ptr<ASTNode> Parser::parseProgram() {
-    auto func = parseFunction();
-    auto root = make_shared<ASTNode>();
-    root->kind = "Program";
-    root->children.push_back(func);
-    return root;
-}
-
-shared_ptr<ASTNode> Parser::parseFunction() {
-    if (!match("KEYWORD", "int")) {
-        error("expected 'int' at function start");
-        return nullptr;
-    }
-    if (!match("KEYWORD", "main")) {
-        error("expected 'main' after 'int'");
-        return nullptr;
-    }
-    expect("SYMBOL", "(");
-    expect("SYMBOL", ")");
-    auto body = parseCompoundStmt();
-
-    auto fn = make_shared<ASTNode>();
-    fn->kind = "Function";
-    fn->value = "main";
-    fn->children.push_back(body);
-    return fn;
-}
-
-shared_ptr<ASTNode> Parser::parseCompoundStmt() {
-    expect("SYMBOL", "{");
-    auto node = make_shared<ASTNode>();
-    node->kind = "Block";
-
-    while (!isAtEnd() && !(peek().type == "SYMBOL" && peek().value == "}")) {
-        node->children.push_back(parseStmt());
-        if (hasError) break; // stop parsing if already errored
-    }
-
-    if (!isAtEnd())
-        expect("SYMBOL", "}");
-    else
-        error("unexpected end-of-file inside block");
-
-    return node;
-}
-
-shared_ptr<ASTNode> Parser::parseStmt() {
-    if (peek().type == "KEYWORD" && (peek().value == "int" || peek().value == "float"))
-        return parseDecl();
-    else if (peek().type == "KEYWORD" && peek().value == "if")
-        return parseIf();
-    else if (peek().type == "KEYWORD" && peek().value == "return")
-        return parseReturn();
-    else if (peek().type == "IDENTIFIER")
-        return parseAssign();
-    else if (peek().type == "SYMBOL" && peek().value == "{")
-        return parseCompoundStmt();
-
-    error("unexpected token '" + peek().value + "' in statement");
-    advance();
-    return nullptr;
-}
-
-shared_ptr<ASTNode> Parser::parseDecl() {
-    string typ = advance().value;
-    if (peek().type != "IDENTIFIER") {
-        error("expected identifier after type declaration");
-        return nullptr;
-    }
-
-    string id = advance().value;
-    auto node = make_shared<ASTNode>("Decl", id);
-    node->children.push_back(make_shared<ASTNode>("Type", typ));
-
-    if (peek().type == "OPERATOR" && peek().value == "=") {
-        advance();
-        node->children.push_back(parseExpr());
-    }
-
-    expect("SYMBOL", ";");
-    return node;
-}
-
-shared_ptr<ASTNode> Parser::parseAssign() {
-    string id = advance().value;
-    if (peek().type != "OPERATOR") {
-        error("expected operator after identifier in assignment");
-        return nullptr;
-    }
-
-    string op = advance().value;
-    auto node = make_shared<ASTNode>("Assign", op);
-    node->children.push_back(make_shared<ASTNode>("Var", id));
-    node->children.push_back(parseExpr());
-    expect("SYMBOL", ";");
-    return node;
-}
-
-shared_ptr<ASTNode> Parser::parseIf() {
-    expect("KEYWORD", "if");
-    expect("SYMBOL", "(");
-    auto cond = parseExpr();
-    expect("SYMBOL", ")");
-
-    shared_ptr<ASTNode> thenNode;
-    if (peek().type == "SYMBOL" && peek().value == "{")
-        thenNode = parseCompoundStmt();
-    else
-        thenNode = parseStmt();
-
-    auto node = make_shared<ASTNode>("If");
-    node->children.push_back(cond);
-    node->children.push_back(thenNode);
-
-    if (peek().type == "KEYWORD" && peek().value == "else") {
-        advance();
-        if (peek().type == "SYMBOL" && peek().value == "{")
-            node->children.push_back(parseCompoundStmt());
-        else
-            node->children.push_back(parseStmt());
-    }
-
-    return node;
-}
-
-shared_ptr<ASTNode> Parser::parseReturn() {
-    expect("KEYWORD", "return");
-    auto expr = parseExpr();
-    expect("SYMBOL", ";");
-
-    auto node = make_shared<ASTNode>("Return");
-    node->children.push_back(expr);
-    return node;
-}
-
-// --------------------- Expressions ---------------------
-shared_ptr<ASTNode> Parser::parseExpr() {
-    auto left = parseAddExpr();
-    while (peek().type == "OPERATOR" &&
-           (peek().value == "<" || peek().value == "<=" || peek().value == ">" ||
-            peek().value == ">=" || peek().value == "==" || peek().value == "!=")) {
-        string op = advance().value;
-        auto newNode = make_shared<ASTNode>("RelOp", op);
-        newNode->children.push_back(left);
-        newNode->children.push_back(parseAddExpr());
-        left = newNode;
-    }
-    return left;
-}
-
-shared_ptr<ASTNode> Parser::parseAddExpr() {
-    auto left = parseTerm();
-    while (peek().type == "OPERATOR" && (peek().value == "+" || peek().value == "-")) {
-        string op = advance().value;
-        auto newNode = make_shared<ASTNode>("BinaryOp", op);
-        newNode->children.push_back(left);
-        newNode->children.push_back(parseTerm());
-        left = newNode;
-    }
-    return left;
-}
-
-shared_ptr<ASTNode> Parser::parseTerm() {
-    auto left = parseFactor();
-    while (peek().type == "OPERATOR" && (peek().value == "*" || peek().value == "/")) {
-        string op = advance().value;
-        auto newNode = make_shared<ASTNode>("BinaryOp", op);
-        newNode->children.push_back(left);
-        newNode->children.push_back(parseFactor());
-        left = newNode;
-    }
-    return left;
-}
-
-shared_ptr<ASTNode> Parser::parseFactor() {
-    if (peek().type == "IDENTIFIER") {
-        string id = advance().value;
-        return make_shared<ASTNode>("Var", id);
-    } else if (peek().type == "NUMBER") {
-        string num = advance().value;
-        return make_shared<ASTNode>("Number", num);
-    } else if (peek().type == "SYMBOL" && peek().value == "(") {
-        advance();
-        auto node = parseExpr();
-        expect("SYMBOL", ")");
-        return node;
-    }
-
-    error("unexpected token in expression: '" + peek().value + "'");
-    advance();
-    return nullptr;
-}
-
-// --------------------- AST Printing ---------------------
-void Parser::printAST(const shared_ptr<ASTNode> &node, int indent) {
-    if (!node) return;
-    for (int i = 0; i < indent; ++i) cout << "  ";
-    if (node->value.empty())
-        cout << node->kind << "\n";
-    else
-        cout << node->kind << " : " << node->value << "\n";
-    for (auto &c : node->children)
-        printAST(c, indent + 1);
-}
+#include "parser.h"
+using namespace std;
+
+static const Token eofToken{};
+
+// --------------------- AST arena ---------------------
+const char *nodeKindName(NodeKind kind) {
+    switch (kind) {
+        case NodeKind::Program:  return "Program";
+        case NodeKind::Function: return "Function";
+        case NodeKind::Block:    return "Block";
+        case NodeKind::Decl:     return "Decl";
+        case NodeKind::Type:     return "Type";
+        case NodeKind::Assign:   return "Assign";
+        case NodeKind::If:       return "If";
+        case NodeKind::Return:   return "Return";
+        case NodeKind::BinaryOp: return "BinaryOp";
+        case NodeKind::RelOp:    return "RelOp";
+        case NodeKind::Var:      return "Var";
+        case NodeKind::Number:   return "Number";
+    }
+    return "?";
+}
+
+const char *valueTypeName(ValueType type) {
+    switch (type) {
+        case ValueType::Int:   return "int";
+        case ValueType::Float: return "float";
+        default:               return "unknown";
+    }
+}
+
+NodeId AST::add(NodeKind kind, SymbolId value, const NodeId *children, size_t n) {
+    ASTNode node;
+    node.kind = kind;
+    node.value = value;
+    node.firstChild = (uint32_t)childIds.size();
+    node.numChildren = (uint32_t)n;
+    childIds.insert(childIds.end(), children, children + n);
+    nodes.push_back(node);
+    return (NodeId)(nodes.size() - 1);
+}
+
+NodeId AST::addNumber(string_view text, Number n) {
+    ASTNode node;
+    node.kind = NodeKind::Number;
+    node.value = symbolNames().intern(text);
+    node.firstChild = (uint32_t)numbers.size();
+    node.numChildren = 0;
+    numbers.push_back(n);
+    nodes.push_back(node);
+    return (NodeId)(nodes.size() - 1);
+}
+
+void AST::clear() {
+    nodes.clear();
+    childIds.clear();
+    numbers.clear();
+    bindings.clear();
+    root = NO_NODE;
+}
+
+// --------------------- Parser constructor ---------------------
+Parser::Parser(Lexer &lex, AST &tree) : lexer(lex), tokens(lex), ast(tree) {}
+
+Parser::Parser(const Lexer &lex, const Token *first, const Token *last, AST &tree)
+    : lexer(lex), tokens(first, last), ast(tree) {}
+
+// --------------------- Utility methods ---------------------
+const Token &Parser::peek() {
+    const Token *tok = tokens.peek();
+    return tok ? *tok : eofToken;
+}
+
+Token Parser::advance() {
+    Token tok = peek();
+    if (!isAtEnd()) tokenIndex++;
+    tokens.advance();
+    return tok;
+}
+
+bool Parser::check(TokenKind kind, TokenId id) {
+    const Token *tok = tokens.peek();
+    return tok && tok->kind == kind && (id == TokenId::None || tok->id == id);
+}
+
+bool Parser::match(TokenKind kind, TokenId id) {
+    if (check(kind, id)) {
+        tokens.advance();
+        tokenIndex++;
+        return true;
+    }
+    return false;
+}
+
+bool Parser::isAtEnd() {
+    return tokens.peek() == nullptr;
+}
+
+// After a lexical error (pulled tokens) only the lexer's message is shown:
+// compilation stops on it, and what follows is usually its consequence
+void Parser::error(const string &msg) {
+    if (!quiet && !lexer.hasErrors()) cout << "Syntax Error: " << msg << "\n";
+    setErrorFlag();
+}
+
+// Expect a specific token or flag an error
+void Parser::expect(TokenKind kind, TokenId id) {
+    if (!match(kind, id)) {
+        string got = isAtEnd() ? "end-of-file" : "'" + string(lexeme(peek())) + "'";
+        error("expected '" + string(id == TokenId::None ? tokenKindName(kind) : tokenIdSpelling(id)) +
+              "' but got " + got);
+    }
+}
+
+void Parser::markSpan(NodeId node, uint32_t first) {
+    if (!spans || node == NO_NODE) return;
+    if (spans->size() <= node) spans->resize(ast.size());
+    (*spans)[node] = {first, tokenIndex};
+}
+
+// --------------------- Grammar Implementation ---------------------
+NodeId Parser::parse() {
+    ast.root = parseProgram();
+    return ast.root;
+}
+
+vector<NodeId> Parser::parseStatementList() {
+    vector<NodeId> stmts;
+    while (!isAtEnd() && !hasError)
+        stmts.push_back(parseStmt());
+    return stmts;
+}
+
+NodeId Parser::parseProgram() {
+    auto func = parseFunction();
+    return ast.add(NodeKind::Program, {}, {func});
+}
+
+NodeId Parser::parseFunction() {
+    if (!match(TokenKind::Keyword, TokenId::KwInt)) {
+        error("expected 'int' at function start");
+        return NO_NODE;
+    }
+    if (!match(TokenKind::Keyword, TokenId::KwMain)) {
+        error("expected 'main' after 'int'");
+        return NO_NODE;
+    }
+    expect(TokenKind::Symbol, TokenId::LParen);
+    expect(TokenKind::Symbol, TokenId::RParen);
+    auto body = parseCompoundStmt();
+
+    return ast.add(NodeKind::Function, (SymbolId)TokenId::KwMain, {body});
+}
+
+NodeId Parser::parseCompoundStmt() {
+    return parseStatements(true);
+}
+
+NodeId Parser::parseStmt() {
+    return parseStatements(false);
+}
+
+// One open Block or If while its nested statements are being parsed
+struct StmtFrame {
+    StmtFrame(NodeKind k, uint32_t start) : kind(k), first(start) {}
+
+    NodeKind kind;
+    uint32_t first;                // index of its first token
+    NodeId cond = NO_NODE;         // If: condition
+    NodeId thenStmt = NO_NODE;     // If: then-branch once parsed
+    bool inElse = false;           // If: currently parsing the else-branch
+    vector<NodeId> stmts;          // Block: statements so far
+};
+
+// Parse one statement (or, with openBlock, a '{ ... }' block) including
+// everything nested in it. Simple statements are parsed directly; Block
+// and If push a frame, and each finished statement is handed to the
+// innermost frame until the outermost construct is complete.
+NodeId Parser::parseStatements(bool openBlock) {
+    enum Step { OPEN_BLOCK, BLOCK_NEXT, CLOSE_BLOCK, BEGIN_STMT };
+    vector<StmtFrame> frames;
+    Step step = openBlock ? OPEN_BLOCK : BEGIN_STMT;
+
+    for (;;) {
+        NodeId done = NO_NODE;
+
+        if (step == OPEN_BLOCK) {
+            uint32_t first = tokenIndex;
+            expect(TokenKind::Symbol, TokenId::LBrace);
+            frames.emplace_back(NodeKind::Block, first);
+            step = BLOCK_NEXT;
+        }
+        if (step == BLOCK_NEXT) {
+            if (!isAtEnd() && !check(TokenKind::Symbol, TokenId::RBrace)) {
+                step = BEGIN_STMT;
+                continue;
+            }
+            step = CLOSE_BLOCK;
+        }
+        if (step == CLOSE_BLOCK) {
+            if (!isAtEnd())
+                expect(TokenKind::Symbol, TokenId::RBrace);
+            else
+                error("unexpected end-of-file inside block");
+            done = ast.add(NodeKind::Block, {}, frames.back().stmts);
+            markSpan(done, frames.back().first);
+            frames.pop_back();
+        }
+        else {  // BEGIN_STMT
+            uint32_t first = tokenIndex;
+            if (check(TokenKind::Keyword, TokenId::KwInt) || check(TokenKind::Keyword, TokenId::KwFloat)) {
+                done = parseDecl();
+                markSpan(done, first);
+            } else if (check(TokenKind::Keyword, TokenId::KwIf)) {
+                StmtFrame f(NodeKind::If, first);
+                f.cond = parseIfHeader();
+                frames.push_back(move(f));
+                continue;                  // then-branch is the next statement
+            } else if (check(TokenKind::Keyword, TokenId::KwReturn)) {
+                done = parseReturn();
+                markSpan(done, first);
+            } else if (check(TokenKind::Identifier)) {
+                done = parseAssign();
+                markSpan(done, first);
+            } else if (check(TokenKind::Symbol, TokenId::LBrace)) {
+                step = OPEN_BLOCK;
+                continue;
+            } else {
+                error("unexpected token '" + string(lexeme(peek())) + "' in statement");
+                advance();
+            }
+        }
+
+        // Hand the finished statement to the enclosing constructs
+        for (;;) {
+            if (frames.empty()) return done;
+            StmtFrame &f = frames.back();
+
+            if (f.kind == NodeKind::Block) {
+                f.stmts.push_back(done);
+                step = hasError ? CLOSE_BLOCK : BLOCK_NEXT; // stop parsing if already errored
+                break;
+            }
+            if (!f.inElse) {
+                f.thenStmt = done;
+                if (check(TokenKind::Keyword, TokenId::KwElse)) {
+                    advance();
+                    f.inElse = true;
+                    step = BEGIN_STMT;
+                    break;
+                }
+                done = ast.add(NodeKind::If, {}, {f.cond, f.thenStmt});
+            } else {
+                done = ast.add(NodeKind::If, {}, {f.cond, f.thenStmt, done});
+            }
+            markSpan(done, f.first);
+            frames.pop_back();
+        }
+    }
+}
+
+NodeId Parser::parseDecl() {
+    SymbolId typ = advance().sym;
+    if (!check(TokenKind::Identifier)) {
+        error("expected identifier after type declaration");
+        return NO_NODE;
+    }
+
+    SymbolId id = advance().sym;
+    NodeId type = ast.add(NodeKind::Type, typ);
+    NodeId node;
+
+    if (check(TokenKind::Operator, TokenId::Assign)) {
+        advance();
+        NodeId init = parseExpr();
+        node = ast.add(NodeKind::Decl, id, {type, init});
+    } else {
+        node = ast.add(NodeKind::Decl, id, {type});
+    }
+
+    expect(TokenKind::Symbol, TokenId::Semi);
+    return node;
+}
+
+NodeId Parser::parseAssign() {
+    SymbolId id = advance().sym;
+    if (!check(TokenKind::Operator)) {
+        error("expected operator after identifier in assignment");
+        return NO_NODE;
+    }
+
+    SymbolId op = advance().sym;
+    NodeId var = ast.add(NodeKind::Var, id);
+    NodeId rhs = parseExpr();
+    NodeId node = ast.add(NodeKind::Assign, op, {var, rhs});
+    expect(TokenKind::Symbol, TokenId::Semi);
+    return node;
+}
+
+// 'if' '(' expr ')' -- the branches are parsed by parseStatements
+NodeId Parser::parseIfHeader() {
+    expect(TokenKind::Keyword, TokenId::KwIf);
+    expect(TokenKind::Symbol, TokenId::LParen);
+    auto cond = parseExpr();
+    expect(TokenKind::Symbol, TokenId::RParen);
+    return cond;
+}
+
+NodeId Parser::parseReturn() {
+    expect(TokenKind::Keyword, TokenId::KwReturn);
+    auto expr = parseExpr();
+    expect(TokenKind::Symbol, TokenId::Semi);
+
+    return ast.add(NodeKind::Return, {}, {expr});
+}
+
+// --------------------- Expressions ---------------------
+// Binding strength of the operator at the current token (0 = none):
+//   1: < <= > >= == !=    2: + -    3: * /
+int Parser::binaryPrecedence() {
+    if (peek().kind != TokenKind::Operator) return 0;
+    switch (peek().id) {
+        case TokenId::Less: case TokenId::LessEq:
+        case TokenId::Greater: case TokenId::GreaterEq:
+        case TokenId::EqEq: case TokenId::NotEq:
+            return 1;
+        case TokenId::Plus: case TokenId::Minus:
+            return 2;
+        case TokenId::Star: case TokenId::Slash:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+NodeId Parser::parseOperand() {
+    if (check(TokenKind::Identifier)) {
+        return ast.add(NodeKind::Var, advance().sym);
+    } else if (check(TokenKind::Number)) {
+        Token tok = advance();
+        return ast.addNumber(lexeme(tok), tok.number());
+    }
+
+    error("unexpected token in expression: '" + string(lexeme(peek())) + "'");
+    advance();
+    return NO_NODE;
+}
+
+// Operator-precedence parser with explicit operand/operator stacks.
+// All binary operators are left-associative; '(' is kept on the operator
+// stack as a barrier (prec 0) until its ')' arrives.
+NodeId Parser::parseExpr() {
+    struct PendingOp {
+        int prec;                  // 0 = open parenthesis
+        SymbolId op;
+    };
+    vector<NodeId> operands;
+    vector<PendingOp> ops;
+
+    auto reduce = [&]() {
+        PendingOp top = ops.back();
+        ops.pop_back();
+        NodeId right = operands.back();
+        operands.pop_back();
+        NodeId left = operands.back();
+        NodeKind kind = (top.prec == 1) ? NodeKind::RelOp : NodeKind::BinaryOp;
+        operands.back() = ast.add(kind, top.op, {left, right});
+    };
+
+    for (;;) {
+        // operand position: any number of '(' then a name or number
+        while (check(TokenKind::Symbol, TokenId::LParen)) {
+            advance();
+            ops.push_back({0, {}});
+        }
+        operands.push_back(parseOperand());
+
+        // operator position: close groups until an operator continues the
+        // expression or nothing does
+        for (;;) {
+            int prec = binaryPrecedence();
+            if (prec > 0) {
+                while (!ops.empty() && ops.back().prec >= prec) reduce();
+                ops.push_back({prec, advance().sym});
+                break;
+            }
+
+            while (!ops.empty() && ops.back().prec > 0) reduce();
+            if (ops.empty()) return operands.back();
+
+            ops.pop_back();            // the group's '('
+            expect(TokenKind::Symbol, TokenId::RParen);
+        }
+    }
+}
+
+// --------------------- AST Printing ---------------------
+// Pre-order walk with an explicit stack. Indentation is capped so very deep
+// trees print in linear time; deeper lines are prefixed with their depth.
+static const int MAX_PRINT_INDENT = 64;
+
+void Parser::printAST(NodeId root, int indent) {
+    vector<pair<NodeId, int>> stack;
+    stack.push_back({root, indent});
+
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (node == NO_NODE) continue;
+
+        for (int i = 0; i < depth && i < MAX_PRINT_INDENT; ++i) cout << "  ";
+        if (depth > MAX_PRINT_INDENT) cout << "[" << depth << "] ";
+        if (ast[node].value == StringInterner::EMPTY)
+            cout << nodeKindName(ast.kind(node)) << "\n";
+        else
+            cout << nodeKindName(ast.kind(node)) << " : " << ast.value(node) << "\n";
+
+        for (size_t i = ast.numChildren(node); i-- > 0;)
+            stack.push_back({ast.child(node, i), depth + 1});
+    }
+}
@@ -1,63 +1,163 @@
-#ifndef PARSER_H
-#define PARSER_H
-
-#include <iostream>
-#include <vector>
-#include <string>
-#include <memory>
-#include "token.h"
-using namespace std;
-
-// --------------------- AST Node ---------------------
-struct ASTNode {
-    string kind;                                // e.g., "BinaryOp", "Var", "Number", etc.
-    string value;                               // e.g., "+", variable name, literal
-    vector<shared_ptr<ASTNode>> children;
-
-    // ✅ Constructors
-    ASTNode() {}
-    ASTNode(const string &k) : kind(k) {}
-    ASTNode(const string &k, const string &v) : kind(k), value(v) {}
-};
-
-// --------------------- Parser Class ---------------------
-class Parser {
-private:
-    vector<Token> tokens;
-    size_t pos = 0;
-    bool hasError = false;
-
-    // Utility methods
-    Token peek();
-    Token advance();
-    bool match(const string &type, const string &value = "");
-    void expect(const string &type, const string &value = "");
-    bool isAtEnd();
-    void error(const string &msg);
-    void setErrorFlag() { hasError = true; }
-
-    // Grammar rules
-    shared_ptr<ASTNode> parseProgram();
-    shared_ptr<ASTNode> parseFunction();
-    shared_ptr<ASTNode> parseCompoundStmt();
-    shared_ptr<ASTNode> parseStmt();
-    shared_ptr<ASTNode> parseDecl();
-    shared_ptr<ASTNode> parseAssign();
-    shared_ptr<ASTNode> parseIf();
-    shared_ptr<ASTNode> parseReturn();
-    shared_ptr<ASTNode> parseExpr();
-    shared_ptr<ASTNode> parseAddExpr();
-    shared_ptr<ASTNode> parseTerm();
-    shared_ptr<ASTNode> parseFactor();
-
-public:
-    Parser(const vector<Token> &toks);
-
-    shared_ptr<ASTNode> parse();
-    void printAST(const shared_ptr<ASTNode> &node, int indent = 0);
-
-    // ✅ Expose error flag for main.cpp
-    bool hasErrors() const { return hasError; }
-};
-
-#endif
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <initializer_list>
+#include "token.h"
+#include "lexer.h"
+#include "intern.h"
+using namespace std;
+
+// --------------------- AST Node ---------------------
+enum class NodeKind : uint8_t {
+    Program, Function, Block, Decl, Type, Assign, If, Return,
+    BinaryOp, RelOp, Var, Number
+};
+
+const char *nodeKindName(NodeKind kind);      // e.g. "BinaryOp"
+
+// Type of a node's value, filled in by semantic analysis
+enum class ValueType : uint8_t { Unknown, Int, Float };
+
+const char *valueTypeName(ValueType type);    // "unknown" / "int" / "float"
+
+using NodeId = uint32_t;                      // index into AST::nodes
+const NodeId NO_NODE = UINT32_MAX;            // missing node (after a syntax error)
+
+// Tokens [first, end) a statement was parsed from (indices into the token
+// sequence; first == NO_SPAN for nodes that are not statements)
+const uint32_t NO_SPAN = UINT32_MAX;
+struct TokenSpan {
+    uint32_t first = NO_SPAN;
+    uint32_t end = 0;
+};
+
+struct ASTNode {
+    NodeKind kind;
+    ValueType type = ValueType::Unknown;
+    SymbolId value;                           // "+", variable name, literal (0 = none)
+    uint32_t firstChild;                      // children are AST::childIds[firstChild ...]
+                                              // (Number: index into AST::numbers)
+    uint32_t numChildren;
+};
+
+// All nodes of one compilation live in a single pool and refer to each
+// other by 32-bit index; destroying (or clearing) the AST frees everything.
+class AST {
+private:
+    vector<ASTNode> nodes;
+    vector<NodeId> childIds;
+    vector<Number> numbers;                   // decoded values of Number nodes
+    vector<SymbolId> bindings;                // per node, 0 = its own name
+
+public:
+    NodeId root = NO_NODE;
+
+    // Node values are ids in symbolNames()
+    NodeId add(NodeKind kind, SymbolId value, const NodeId *children, size_t n);
+    NodeId add(NodeKind kind, SymbolId value = 0, initializer_list<NodeId> children = {}) {
+        return add(kind, value, children.begin(), children.size());
+    }
+    NodeId add(NodeKind kind, SymbolId value, const vector<NodeId> &children) {
+        return add(kind, value, children.data(), children.size());
+    }
+
+    // Literal node: keeps its spelling (for printing) and its decoded value
+    NodeId addNumber(string_view text, Number n);
+
+    const ASTNode &operator[](NodeId id) const { return nodes[id]; }
+    NodeKind kind(NodeId id) const { return nodes[id].kind; }
+    SymbolId symbol(NodeId id) const { return nodes[id].value; }
+    string_view value(NodeId id) const { return symbolNames().str(nodes[id].value); }
+    size_t numChildren(NodeId id) const { return nodes[id].numChildren; }
+    NodeId child(NodeId id, size_t i) const { return childIds[nodes[id].firstChild + i]; }
+    size_t size() const { return nodes.size(); }
+    const Number &number(NodeId id) const { return numbers[nodes[id].firstChild]; }
+    ValueType type(NodeId id) const { return id == NO_NODE ? ValueType::Unknown : nodes[id].type; }
+    void setType(NodeId id, ValueType type) { nodes[id].type = type; }
+
+    // Variable a Decl, Var or assignment target stands for, filled in by
+    // semantic analysis: its name unless the declaration shadows (or
+    // repeats in a sibling block) an earlier one of the same name
+    SymbolId binding(NodeId id) const {
+        return (id < bindings.size() && bindings[id]) ? bindings[id] : nodes[id].value;
+    }
+    void bind(NodeId id, SymbolId var) {
+        if (id >= bindings.size()) bindings.resize(nodes.size(), 0);
+        bindings[id] = var;
+    }
+
+    // Patch one child slot in place (incremental re-parse)
+    void setChild(NodeId id, size_t i, NodeId c) { childIds[nodes[id].firstChild + i] = c; }
+
+    void clear();
+};
+
+// --------------------- Parser Class ---------------------
+class Parser {
+private:
+    const Lexer &lexer;
+    TokenCursor tokens;           // pulls tokens from the lexer on demand
+    AST &ast;
+    bool hasError = false;
+    bool quiet = false;                 // errors are flagged but not printed
+    uint32_t tokenIndex = 0;            // index of the current token
+    vector<TokenSpan> *spans = nullptr; // statement spans, if requested
+
+    // Utility methods
+    const Token &peek();
+    Token advance();
+    bool check(TokenKind kind, TokenId id = TokenId::None);
+    bool match(TokenKind kind, TokenId id = TokenId::None);
+    void expect(TokenKind kind, TokenId id = TokenId::None);
+    string_view lexeme(const Token &tok) const { return lexer.text(tok); }
+    bool isAtEnd();
+    void error(const string &msg);
+    void setErrorFlag() { hasError = true; }
+
+    // Grammar rules. Blocks, ifs and parenthesized expressions nest through
+    // explicit stacks rather than recursion, so deeply nested input cannot
+    // overflow the native stack.
+    NodeId parseProgram();
+    NodeId parseFunction();
+    NodeId parseCompoundStmt();
+    NodeId parseStmt();
+    NodeId parseStatements(bool openBlock);
+    NodeId parseDecl();
+    NodeId parseAssign();
+    NodeId parseIfHeader();
+    NodeId parseReturn();
+    NodeId parseExpr();
+    NodeId parseOperand();
+    int binaryPrecedence();
+    void markSpan(NodeId node, uint32_t first);
+
+public:
+    Parser(Lexer &lex, AST &tree);
+    // Parse tokens [first, last) lexed earlier; lex supplies their text
+    Parser(const Lexer &lex, const Token *first, const Token *last, AST &tree);
+
+    // Record the span of every statement into spans[node]; the first token
+    // has index firstIndex
+    void recordSpans(vector<TokenSpan> &out, uint32_t firstIndex = 0) {
+        spans = &out;
+        tokenIndex = firstIndex;
+    }
+
+    // Syntax errors only set the error flag (a partial re-parse leaves
+    // reporting them to a full one)
+    void silence() { quiet = true; }
+
+    NodeId parse();
+    // Statements up to the end of the tokens (re-parsing part of a block)
+    vector<NodeId> parseStatementList();
+    void printAST(NodeId node, int indent = 0);
+
+    // ✅ Expose error flag for main.cpp
+    bool hasErrors() const { return hasError; }
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "regalloc.h"
+#include "cfg.h"
+#include <algorithm>
+
+using namespace std;
+
+RegisterAssignment::RegisterAssignment(const vector<Quad> &code, int regs)
+    : registers(max(regs, MIN_REGISTERS)), vars(code) {
+    scratch[0] = registers - 2;
+    scratch[1] = registers - 1;
+    reg.assign(vars.size(), -1);
+    slot.assign(vars.size(), -1);
+    if (code.empty()) return;
+
+    // Live intervals: every mention, stretched to the block boundaries the
+    // value is live across
+    const uint32_t NONE = UINT32_MAX;
+    vector<LiveInterval> intervals(vars.size());
+    for (uint32_t v = 0; v < vars.size(); ++v) intervals[v] = {v, NONE, 0};
+    auto cover = [&](uint32_t v, uint32_t pos) {
+        intervals[v].start = min(intervals[v].start, pos);
+        intervals[v].end = max(intervals[v].end, pos);
+    };
+
+    // Only a value mentioned in several blocks, or read before it is
+    // written in its block, can be live at a block boundary; the rest
+    // (most temps) live between their first and last mention and are
+    // left out of the global liveness
+    CFG cfg(code);
+    vector<int32_t> home(vars.size(), -1), writtenIn(vars.size(), -1);
+    vector<char> global(vars.size(), 0);
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        const BasicBlock &bb = cfg.blocks[b];
+        for (uint32_t i = bb.first; i < bb.last; ++i) {
+            const Quad &q = code[i];
+            for (const Operand *o : {&q.a, &q.b, &q.dst}) {
+                int32_t v = vars.of(*o);
+                if (v < 0) continue;
+                cover((uint32_t)v, i);
+                if (home[v] < 0) home[v] = (int32_t)b;
+                else if (home[v] != (int32_t)b) global[v] = 1;
+                if (o == &q.dst && assignsValue(q)) writtenIn[v] = (int32_t)b;
+                else if (writtenIn[v] != (int32_t)b) global[v] = 1;
+            }
+        }
+    }
+
+    OperandIndex globals(vars, global);
+    vector<uint32_t> bitOf;   // globals bit -> vars bit
+    for (uint32_t v = 0; v < vars.size(); ++v)
+        if (global[v]) bitOf.push_back(v);
+    DataflowResult live = liveVariables(code, cfg, globals);
+    for (uint32_t b = 0; b < cfg.size(); ++b) {
+        const BasicBlock &bb = cfg.blocks[b];
+        live.in[b].forEach([&](size_t g) { cover(bitOf[g], bb.first); });
+        live.out[b].forEach([&](size_t g) { cover(bitOf[g], bb.last - 1); });
+    }
+
+    // What each operand is, and whether its interval opens with its
+    // assignment (rather than with a read of an uninitialized value)
+    vector<char> isTemp(vars.size(), 0), startsAtDef(vars.size(), 0);
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        int32_t v = vars.of(code[i].dst);
+        if (v < 0) continue;
+        isTemp[v] = code[i].dst.isTemp();
+        if (intervals[v].start == i && assignsValue(code[i])) startsAtDef[v] = 1;
+    }
+    for (uint32_t i = 0; i < code.size(); ++i)
+        for (const Operand *o : {&code[i].a, &code[i].b})
+            if (o->isTemp()) isTemp[vars.of(*o)] = 1;
+
+    vector<LiveInterval> order;
+    for (const LiveInterval &iv : intervals)
+        if (iv.start != NONE) order.push_back(iv);
+    sort(order.begin(), order.end(), [](const LiveInterval &x, const LiveInterval &y) {
+        return x.start != y.start ? x.start < y.start : x.operand < y.operand;
+    });
+
+    // Scan in order of start; `active` is kept sorted by end
+    vector<int> freeRegs;
+    for (int r = registers - 3; r >= 0; --r) freeRegs.push_back(r);
+    vector<LiveInterval> active;
+    auto spill = [&](uint32_t v) {
+        reg[v] = -1;
+        // variables live in their own memory symbol; temps need a slot
+        if (isTemp[v]) slot[v] = (int32_t)spillSlots++;
+    };
+
+    for (const LiveInterval &cur : order) {
+        // expire intervals that ended; one whose last read is the
+        // instruction assigning this one can hand over its register
+        // (codegen reads the operands before writing the result)
+        size_t keep = 0;
+        for (const LiveInterval &a : active) {
+            if (a.end < cur.start || (a.end == cur.start && startsAtDef[cur.operand]))
+                freeRegs.push_back(reg[a.operand]);
+            else active[keep++] = a;
+        }
+        active.resize(keep);
+
+        if (freeRegs.empty()) {
+            LiveInterval &last = active.back();
+            if (last.end > cur.end) {
+                reg[cur.operand] = reg[last.operand];
+                spill(last.operand);
+                active.pop_back();
+            } else {
+                spill(cur.operand);
+                continue;
+            }
+        } else {
+            reg[cur.operand] = freeRegs.back();
+            freeRegs.pop_back();
+        }
+        auto at = upper_bound(active.begin(), active.end(), cur,
+                              [](const LiveInterval &x, const LiveInterval &y) { return x.end < y.end; });
+        active.insert(at, cur);
+    }
+}
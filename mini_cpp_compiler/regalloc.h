@@ -0,0 +1,52 @@
+#ifndef REGALLOC_H
+#define REGALLOC_H
+
+#include <cstdint>
+#include <vector>
+#include "tac.h"
+#include "dataflow.h"
+
+// Linear-scan register allocation (Poletto & Sarkar) for a TAC function.
+// - Temporaries and user variables both compete for registers: the
+//   language has no address-of and no calls, so no variable escapes and
+//   every one can be promoted out of memory.
+// - A live interval runs from the first to the last instruction where
+//   the value is live (liveness decides across branches).
+// - When no register is free, the interval that ends last is spilled
+//   whole: a spilled variable stays in its memory symbol, a spilled temp
+//   gets a stack slot, and codegen reloads / stores it through one of the
+//   two scratch registers kept out of the allocation.
+struct LiveInterval {
+    uint32_t operand;                 // OperandIndex bit
+    uint32_t start, end;              // instruction positions, inclusive
+};
+
+class RegisterAssignment {
+public:
+    RegisterAssignment(const std::vector<Quad> &code, int registers);
+
+    int registers;                    // size of the register file
+    int scratch[2];                   // reserved for reloads and results
+    size_t spillSlots = 0;            // stack slots used by spilled temps
+
+    // Register holding o for its whole life, -1 if it lives in memory
+    // (or is not a variable/temp)
+    int32_t regOf(const Operand &o) const {
+        int32_t bit = vars.of(o);
+        return bit < 0 ? -1 : reg[bit];
+    }
+    // Stack slot of a spilled temp, -1 otherwise
+    int32_t slotOf(const Operand &o) const {
+        int32_t bit = vars.of(o);
+        return bit < 0 ? -1 : slot[bit];
+    }
+
+private:
+    OperandIndex vars;
+    std::vector<int32_t> reg, slot;   // per operand bit
+};
+
+// Smallest register file the allocator accepts (two allocatable + two scratch)
+constexpr int MIN_REGISTERS = 4;
+
+#endif // REGALLOC_H
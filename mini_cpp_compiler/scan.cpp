@@ -0,0 +1,278 @@
+#include "scan.h"
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SCAN_HAVE_X86 1
+#endif
+
+using namespace std;
+
+// -----------------------------
+// Scalar versions
+// -----------------------------
+static inline bool isIdentByte(unsigned char c) {
+    return (unsigned char)((c | 0x20) - 'a') < 26 || (unsigned char)(c - '0') < 10 || c == '_';
+}
+
+static inline bool isDigitDotByte(unsigned char c) {
+    return (unsigned char)(c - '0') < 10 || c == '.';
+}
+
+static inline bool isSpaceByte(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') < 5;   // \t \n \v \f \r
+}
+
+static size_t identRunScalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && isIdentByte((unsigned char)p[i])) i++;
+    return i;
+}
+
+static size_t digitRunScalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && isDigitDotByte((unsigned char)p[i])) i++;
+    return i;
+}
+
+static size_t spaceRunScalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && isSpaceByte((unsigned char)p[i])) i++;
+    return i;
+}
+
+static size_t findNewlineScalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && p[i] != '\n') i++;
+    return i;
+}
+
+static size_t findCommentEndScalar(const char *p, size_t n) {
+    for (size_t i = 0; i + 1 < n; ++i)
+        if (p[i] == '*' && p[i + 1] == '/') return i;
+    return n;
+}
+
+static size_t findSlashOrQuoteScalar(const char *p, size_t n) {
+    size_t i = 0;
+    while (i < n && p[i] != '/' && p[i] != '"') i++;
+    return i;
+}
+
+static const ScanOps scalarOps = {
+    "scalar", identRunScalar, digitRunScalar, spaceRunScalar,
+    findNewlineScalar, findCommentEndScalar, findSlashOrQuoteScalar
+};
+
+#ifdef SCAN_HAVE_X86
+// -----------------------------
+// SIMD versions
+// -----------------------------
+// Byte-range tests use the signed-compare trick: after adding (0x80 - lo),
+// bytes in [lo, hi] are exactly those below (int8)(0x80 + hi - lo + 1).
+// Every loop computes a bitmask of "stop" bytes per block; the first set
+// bit is the answer. The remaining tail is finished by the scalar code.
+
+#define SCAN_RANGE128(x, lo, hi) \
+    _mm_cmplt_epi8(_mm_add_epi8((x), _mm_set1_epi8((char)(0x80 - (lo)))), \
+                   _mm_set1_epi8((char)(0x80 + (hi) - (lo) + 1)))
+
+static inline int ctz32(uint32_t m) { return __builtin_ctz(m); }
+
+static size_t identRunSSE2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+        __m128i ok = _mm_or_si128(SCAN_RANGE128(lower, 'a', 'z'), SCAN_RANGE128(x, '0', '9'));
+        ok = _mm_or_si128(ok, _mm_cmpeq_epi8(x, _mm_set1_epi8('_')));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(ok) & 0xFFFF;
+        if (stop) return i + ctz32(stop);
+    }
+    return i + identRunScalar(p + i, n - i);
+}
+
+static size_t digitRunSSE2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i ok = _mm_or_si128(SCAN_RANGE128(x, '0', '9'), _mm_cmpeq_epi8(x, _mm_set1_epi8('.')));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(ok) & 0xFFFF;
+        if (stop) return i + ctz32(stop);
+    }
+    return i + digitRunScalar(p + i, n - i);
+}
+
+static size_t spaceRunSSE2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i ok = _mm_or_si128(SCAN_RANGE128(x, '\t', '\r'), _mm_cmpeq_epi8(x, _mm_set1_epi8(' ')));
+        uint32_t stop = ~(uint32_t)_mm_movemask_epi8(ok) & 0xFFFF;
+        if (stop) return i + ctz32(stop);
+    }
+    return i + spaceRunScalar(p + i, n - i);
+}
+
+static size_t findNewlineSSE2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        uint32_t hit = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+        if (hit) return i + ctz32(hit);
+    }
+    return i + findNewlineScalar(p + i, n - i);
+}
+
+static size_t findCommentEndSSE2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 17 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + i + 1));
+        __m128i both = _mm_and_si128(_mm_cmpeq_epi8(a, _mm_set1_epi8('*')),
+                                     _mm_cmpeq_epi8(b, _mm_set1_epi8('/')));
+        uint32_t hit = (uint32_t)_mm_movemask_epi8(both);
+        if (hit) return i + ctz32(hit);
+    }
+    return i + findCommentEndScalar(p + i, n - i);
+}
+
+static size_t findSlashOrQuoteSSE2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i hitv = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('/')),
+                                    _mm_cmpeq_epi8(x, _mm_set1_epi8('"')));
+        uint32_t hit = (uint32_t)_mm_movemask_epi8(hitv);
+        if (hit) return i + ctz32(hit);
+    }
+    return i + findSlashOrQuoteScalar(p + i, n - i);
+}
+
+#define SCAN_RANGE256(x, lo, hi) \
+    _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + (hi) - (lo) + 1)), \
+                      _mm256_add_epi8((x), _mm256_set1_epi8((char)(0x80 - (lo)))))
+
+__attribute__((target("avx2")))
+static size_t identRunAVX2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+        __m256i ok = _mm256_or_si256(SCAN_RANGE256(lower, 'a', 'z'), SCAN_RANGE256(x, '0', '9'));
+        ok = _mm256_or_si256(ok, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('_')));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(ok);
+        if (stop) return i + ctz32(stop);
+    }
+    return i + identRunSSE2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t digitRunAVX2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i ok = _mm256_or_si256(SCAN_RANGE256(x, '0', '9'), _mm256_cmpeq_epi8(x, _mm256_set1_epi8('.')));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(ok);
+        if (stop) return i + ctz32(stop);
+    }
+    return i + digitRunSSE2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t spaceRunAVX2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i ok = _mm256_or_si256(SCAN_RANGE256(x, '\t', '\r'), _mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(ok);
+        if (stop) return i + ctz32(stop);
+    }
+    return i + spaceRunSSE2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t findNewlineAVX2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        uint32_t hit = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+        if (hit) return i + ctz32(hit);
+    }
+    return i + findNewlineSSE2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t findCommentEndAVX2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 33 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 1));
+        __m256i both = _mm256_and_si256(_mm256_cmpeq_epi8(a, _mm256_set1_epi8('*')),
+                                        _mm256_cmpeq_epi8(b, _mm256_set1_epi8('/')));
+        uint32_t hit = (uint32_t)_mm256_movemask_epi8(both);
+        if (hit) return i + ctz32(hit);
+    }
+    return i + findCommentEndSSE2(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t findSlashOrQuoteAVX2(const char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i hitv = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('/')),
+                                       _mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')));
+        uint32_t hit = (uint32_t)_mm256_movemask_epi8(hitv);
+        if (hit) return i + ctz32(hit);
+    }
+    return i + findSlashOrQuoteSSE2(p + i, n - i);
+}
+
+static const ScanOps sse2Ops = {
+    "sse2", identRunSSE2, digitRunSSE2, spaceRunSSE2,
+    findNewlineSSE2, findCommentEndSSE2, findSlashOrQuoteSSE2
+};
+
+static const ScanOps avx2Ops = {
+    "avx2", identRunAVX2, digitRunAVX2, spaceRunAVX2,
+    findNewlineAVX2, findCommentEndAVX2, findSlashOrQuoteAVX2
+};
+
+static bool cpuHasAVX2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif // SCAN_HAVE_X86
+
+// -----------------------------
+// Runtime Selection
+// -----------------------------
+static const ScanOps *forcedOps = nullptr;
+
+static const ScanOps *detectScanOps() {
+#ifdef SCAN_HAVE_X86
+    if (cpuHasAVX2()) return &avx2Ops;
+    return &sse2Ops;   // part of the x86-64 baseline
+#else
+    return &scalarOps;
+#endif
+}
+
+const ScanOps &scanOps() {
+    static const ScanOps *best = detectScanOps();
+    return forcedOps ? *forcedOps : *best;
+}
+
+const ScanOps *findScanOps(const string &name) {
+    if (name == "scalar") return &scalarOps;
+#ifdef SCAN_HAVE_X86
+    if (name == "sse2") return &sse2Ops;
+    if (name == "avx2" && cpuHasAVX2()) return &avx2Ops;
+#endif
+    return nullptr;
+}
+
+void setScanOps(const ScanOps &ops) {
+    forcedOps = &ops;
+}
@@ -0,0 +1,36 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <string>
+
+// Character-class scanners used by the lexer's hot loops.
+// Each function looks at [p, p + n) and returns an index <= n:
+//   identRun       - length of the leading run of [A-Za-z0-9_]
+//   digitRun       - length of the leading run of [0-9.]
+//   spaceRun       - length of the leading run of isspace() bytes
+//   findNewline    - index of the first '\n', or n
+//   findCommentEnd - index of the first "*/", or n
+//   findSlashOrQuote - index of the first '/' or '"', or n
+// Scalar, SSE2 and AVX2 versions exist; the best one the CPU supports is
+// picked once at runtime.
+struct ScanOps {
+    const char *name;
+    size_t (*identRun)(const char *p, size_t n);
+    size_t (*digitRun)(const char *p, size_t n);
+    size_t (*spaceRun)(const char *p, size_t n);
+    size_t (*findNewline)(const char *p, size_t n);
+    size_t (*findCommentEnd)(const char *p, size_t n);
+    size_t (*findSlashOrQuote)(const char *p, size_t n);
+};
+
+// Scanner in use (best available unless overridden by setScanOps)
+const ScanOps &scanOps();
+
+// Lookup by name ("scalar", "sse2", "avx2"); nullptr if not supported here
+const ScanOps *findScanOps(const std::string &name);
+
+// Force a specific implementation (benchmarks / testing)
+void setScanOps(const ScanOps &ops);
+
+#endif // SCAN_H
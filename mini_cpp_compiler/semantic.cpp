@@ -1,97 +1,259 @@
-#include "semantic.h"
-using namespace std;
-
-string SemanticAnalyzer::inferType(const shared_ptr<ASTNode> &node) {
-    if (!node) return "unknown";
-
-    if (node->kind == "Number") {
-        return (node->value.find('.') != string::npos) ? "float" : "int";
-    }
-    else if (node->kind == "Var") {
-        if (symbolTable.find(node->value) == symbolTable.end()) {
-            cout << "Semantic Error: Variable '" << node->value
-                 << "' used before declaration.\n";
-            setErrorFlag();
-            return "unknown";
-        }
-        return symbolTable[node->value].type;
-    }
-    else if (node->kind == "BinaryOp" || node->kind == "RelOp") {
-        string leftType = inferType(node->children[0]);
-        string rightType = inferType(node->children[1]);
-        if (leftType == "unknown" || rightType == "unknown")
-            return "unknown";
-        return (leftType == "float" || rightType == "float") ? "float" : "int";
-    }
-    else if (node->kind == "Assign") {
-        string varName = node->children[0]->value;
-
-        // Check undeclared variable
-        if (symbolTable.find(varName) == symbolTable.end()) {
-            cout << "Semantic Error: Variable '" << varName
-                 << "' used before declaration.\n";
-            setErrorFlag();
-            inferType(node->children[1]); // still check RHS
-            return "unknown";
-        }
-
-        // Check assignment type
-        string varType = symbolTable[varName].type;
-        string exprType = inferType(node->children[1]);
-        if (exprType != "unknown" && varType != exprType) {
-            cout << "Type Mismatch: Cannot assign " << exprType
-                 << " to variable '" << varName << "' of type "
-                 << varType << ".\n";
-            setErrorFlag();
-        }
-        return varType;
-    }
-    else {
-        for (auto &c : node->children)
-            inferType(c);
-        return "unknown";
-    }
-}
-
-void SemanticAnalyzer::analyzeNode(const shared_ptr<ASTNode> &node) {
-    if (!node) return;
-
-    // Handle declarations
-    if (node->kind == "Decl") {
-        string varName = node->value;
-        string varType = node->children[0]->value;
-
-        if (symbolTable.count(varName)) {
-            cout << "Semantic Error: Variable '" << varName << "' redeclared.\n";
-            setErrorFlag();
-        } else {
-            symbolTable[varName] = {varName, varType};
-        }
-
-        // If initialized, check initializer expression
-        if (node->children.size() > 1)
-            inferType(node->children[1]);
-    }
-
-    // Recursively analyze children
-    for (auto &c : node->children)
-        analyzeNode(c);
-
-    // Perform type inference for key nodes
-    if (node->kind == "If" || node->kind == "Return" || node->kind == "Block")
-        inferType(node);
-}
-
-void SemanticAnalyzer::analyze(const shared_ptr<ASTNode> &root) {
-    cout << "\n===== SEMANTIC ANALYSIS =====\n";
-    analyzeNode(root);
-
-    cout << "\nSymbol Table:\n";
-    for (auto &entry : symbolTable)
-        cout << "  " << entry.second.name << " : " << entry.second.type << "\n";
-
-    if (!hasErrors())
-        cout << "No semantic errors found.\n";
-    else
-        cout << "Semantic errors detected. See messages above.\n";
-}
+#include "semantic.h"
+#include <algorithm>
+using namespace std;
+
+// --------------------- Symbol table ---------------------
+SymbolTable::SymbolTable() : slots(64, Slot{0, UNBOUND}) {}
+
+size_t SymbolTable::find(SymbolId name) const {
+    size_t mask = slots.size() - 1;
+    size_t i = (name * 2654435761u) & mask;
+    while (slots[i].name != 0 && slots[i].name != name) i = (i + 1) & mask;
+    return i;
+}
+
+void SymbolTable::grow() {
+    vector<Slot> old(slots.size() * 2, Slot{0, UNBOUND});
+    old.swap(slots);
+    for (const Slot &s : old)
+        if (s.name != 0) slots[find(s.name)] = s;
+}
+
+void SymbolTable::enterScope() {
+    uint32_t depth = (uint32_t)open.size() + 1;
+    open.push_back((uint32_t)scopes.size());
+    scopes.push_back({depth, undo.size()});
+}
+
+void SymbolTable::leaveScope() {
+    size_t mark = scopes[open.back()].undoMark;
+    while (undo.size() > mark) {
+        slots[find(undo.back().name)].binding = undo.back().previous;
+        undo.pop_back();
+    }
+    open.pop_back();
+}
+
+const Symbol *SymbolTable::lookup(SymbolId name) const {
+    const Slot &s = slots[find(name)];
+    return (s.name != 0 && s.binding != UNBOUND) ? &symbols[s.binding] : nullptr;
+}
+
+bool SymbolTable::declaredHere(SymbolId name) const {
+    const Symbol *sym = lookup(name);
+    return sym && !open.empty() && sym->scope == open.back();
+}
+
+void SymbolTable::declare(SymbolId name, ValueType type, SymbolId var) {
+    if (open.empty()) enterScope();
+    size_t i = find(name);
+    if (slots[i].name == 0) {
+        slots[i] = {name, UNBOUND};
+        if (++used * 2 > slots.size()) {
+            grow();
+            i = find(name);
+        }
+    }
+    undo.push_back({name, slots[i].binding});
+    slots[i].binding = (uint32_t)symbols.size();
+    symbols.push_back({name, type, open.back(), var});
+}
+
+// Scopes in the order they were entered; names sorted within each one
+void SemanticAnalyzer::printSymbolTable() const {
+    cout << "\nSymbol Table:\n";
+    const vector<Symbol> &all = symbolTable.allSymbols();
+    vector<const Symbol *> order;
+    for (const Symbol &sym : all) order.push_back(&sym);
+    stable_sort(order.begin(), order.end(), [](const Symbol *a, const Symbol *b) {
+        if (a->scope != b->scope) return a->scope < b->scope;
+        return symbolNames().str(a->name) < symbolNames().str(b->name);
+    });
+
+    uint32_t shown = 0;   // scope 0 (the function body) has no heading
+    for (const Symbol *sym : order) {
+        uint32_t depth = symbolTable.allScopes()[sym->scope].depth;
+        if (sym->scope != shown) {
+            shown = sym->scope;
+            cout << string(2 * depth - 2, ' ') << "block " << shown << ":\n";
+        }
+        cout << string(2 * depth, ' ') << symbolNames().str(sym->name)
+             << " : " << valueTypeName(sym->type) << "\n";
+    }
+}
+
+// One post-order walk with an explicit stack of (node, next child) frames:
+// deep nesting cannot overflow the native stack, and every node is typed
+// exactly once, from the types already stored on its children.
+struct WalkFrame {
+    NodeId node;
+    uint32_t next;     // index of the next child to visit
+};
+
+// Innermost visible declaration; past the statement's own scopes,
+// analyzeStatement looks in the outer scope and records what it found
+const Symbol *SemanticAnalyzer::lookup(SymbolId name) {
+    const Symbol *sym = symbolTable.lookup(name);
+    if (sym || !outer) return sym;
+    sym = (*outer)(name);
+    unit->resolved.push_back(sym ? *sym : Symbol{name, ValueType::Unknown, 0, 0});
+    return sym;
+}
+
+// Diagnostics are printed, or kept with the statement analyzed alone
+void SemanticAnalyzer::report(const string &msg) {
+    if (unit) unit->messages += msg;
+    else cout << msg;
+    setErrorFlag();
+}
+
+// Type named by a Type node ("int" / "float")
+static ValueType namedType(const AST &t, NodeId typeNode) {
+    return (t.symbol(typeNode) == (SymbolId)TokenId::KwFloat) ? ValueType::Float : ValueType::Int;
+}
+
+// Type of a node whose children are done (prints its errors)
+ValueType SemanticAnalyzer::nodeType(NodeId node) {
+    AST &t = *ast;
+    switch (t.kind(node)) {
+        case NodeKind::Number:
+            return t.number(node).isFloat ? ValueType::Float : ValueType::Int;
+
+        case NodeKind::Type:
+            return namedType(t, node);
+
+        case NodeKind::Var: {
+            const Symbol *sym = lookup(t.symbol(node));
+            if (sym) {
+                t.bind(node, sym->var);
+                return sym->type;
+            }
+            report("Semantic Error: Variable '" + string(t.value(node)) +
+                   "' used before declaration.\n");
+            return ValueType::Unknown;
+        }
+
+        case NodeKind::BinaryOp:
+        case NodeKind::RelOp: {
+            ValueType left = t.type(t.child(node, 0));
+            ValueType right = t.type(t.child(node, 1));
+            if (left == ValueType::Unknown || right == ValueType::Unknown)
+                return ValueType::Unknown;
+            return (left == ValueType::Float || right == ValueType::Float) ? ValueType::Float : ValueType::Int;
+        }
+
+        case NodeKind::Assign: {
+            NodeId target = t.child(node, 0);
+            const Symbol *sym = lookup(t.symbol(target));
+            if (!sym) return ValueType::Unknown;
+            t.setType(target, sym->type);
+            t.bind(target, sym->var);
+
+            // Check assignment type
+            ValueType exprType = t.type(t.child(node, 1));
+            if (exprType != ValueType::Unknown && exprType != sym->type) {
+                report("Type Mismatch: Cannot assign " + string(valueTypeName(exprType)) +
+                       " to variable '" + string(t.value(target)) + "' of type " +
+                       valueTypeName(sym->type) + ".\n");
+            }
+            return sym->type;
+        }
+
+        case NodeKind::Decl:
+            return t.type(t.child(node, 0));
+
+        default:
+            return ValueType::Unknown;
+    }
+}
+
+// The first declaration of a name is the TAC variable of that name; later
+// ones (shadowing or in sibling blocks) become "name.1", "name.2", ...,
+// which no identifier can spell. A statement analyzed alone keeps the bare
+// names for the top-level scope, which other statements share.
+SymbolId SemanticAnalyzer::variableFor(SymbolId name) {
+    uint32_t &count = declarations[name];
+    if (outer && symbolTable.depth() == 1) return name;
+    if (outer && count == 0) count = 1;
+    if (count++ == 0) return name;
+    return symbolNames().intern(string(symbolNames().str(name)) + "." + to_string(count - 1));
+}
+
+void SemanticAnalyzer::analyzeNode(NodeId root) {
+    AST &t = *ast;
+    vector<WalkFrame> stack;
+
+    stack.push_back({root, 0});
+    while (!stack.empty()) {
+        WalkFrame &f = stack.back();
+        NodeId node = f.node;
+        if (node == NO_NODE) {
+            stack.pop_back();
+            continue;
+        }
+
+        // On the way down: scopes, declarations, and assignment targets
+        // (reported before the right-hand side is checked)
+        NodeKind kind = t.kind(node);
+        if (f.next == 0 && kind == NodeKind::Block)
+            symbolTable.enterScope();
+        if (f.next == 0 && kind == NodeKind::Decl) {
+            // an outer declaration of the same name is shadowed
+            SymbolId varName = t.symbol(node);
+            bool outerHere = outer && symbolTable.depth() == 1 && lookup(varName);
+            if (symbolTable.declaredHere(varName) || outerHere) {
+                report("Semantic Error: Variable '" + string(t.value(node)) + "' redeclared.\n");
+            } else {
+                SymbolId var = variableFor(varName);
+                symbolTable.declare(varName, namedType(t, t.child(node, 0)), var);
+                t.bind(node, var);
+            }
+        }
+        if (f.next == 0 && kind == NodeKind::Assign && !lookup(t.symbol(t.child(node, 0)))) {
+            report("Semantic Error: Variable '" + string(t.value(t.child(node, 0))) +
+                   "' used before declaration.\n");
+        }
+
+        // Analyze children (an Assign's target is not an expression)
+        uint32_t first = (kind == NodeKind::Assign) ? 1 : 0;
+        if (first + f.next < t.numChildren(node)) {
+            NodeId c = t.child(node, first + f.next++);
+            stack.push_back({c, 0});
+            continue;
+        }
+        stack.pop_back();
+
+        // On the way up: the children are typed, so is this node
+        t.setType(node, nodeType(node));
+        if (kind == NodeKind::Block)
+            symbolTable.leaveScope();
+    }
+}
+
+void SemanticAnalyzer::analyze(AST &tree) {
+    if (listing) cout << "\n===== SEMANTIC ANALYSIS =====\n";
+    ast = &tree;
+    analyzeNode(tree.root);
+    if (!listing) return;
+
+    printSymbolTable();
+
+    if (!hasErrors())
+        cout << "No semantic errors found.\n";
+    else
+        cout << "Semantic errors detected. See messages above.\n";
+}
+
+void SemanticAnalyzer::analyzeStatement(AST &tree, NodeId stmt, const OuterScope &scope,
+                                        StatementSemantics &out) {
+    out = StatementSemantics();
+    ast = &tree;
+    outer = &scope;
+    unit = &out;
+    symbolTable.enterScope();             // main's body: scope 0
+    analyzeNode(stmt);
+
+    out.hasError = hasError;
+    for (const Symbol &sym : symbolTable.allSymbols())
+        if (sym.scope == 0) out.declared.push_back(sym);
+}
@@ -1,45 +1,132 @@
-#ifndef SEMANTIC_H
-#define SEMANTIC_H
-
-#include <iostream>
-#include <map>
-#include <string>
-#include "parser.h"
-using namespace std;
-
-// Represents an entry in the symbol table
-struct Symbol {
-    string name;
-    string type;
-};
-
-// Semantic Analyzer class: performs symbol checks, type checks, etc.
-class SemanticAnalyzer {
-private:
-    map<string, Symbol> symbolTable;  // variable name → symbol info
-    bool hasError = false;            // flag for semantic errors
-
-    // Internal helper functions
-    string inferType(const shared_ptr<ASTNode> &node);
-    void analyzeNode(const shared_ptr<ASTNode> &node);
-
-public:
-    // Run semantic analysis on the AST
-    void analyze(const shared_ptr<ASTNode> &root);
-
-    // Query: did we encounter semantic errors?
-    bool hasErrors() const { return hasError; }
-
-    // Optional: print symbol table (helpful for debugging/report)
-    void printSymbolTable() const {
-        cout << "\nSymbol Table:\n";
-        for (const auto &entry : symbolTable) {
-            cout << "  " << entry.first << " : " << entry.second.type << "\n";
-        }
-    }
-
-    // Allow semantic.cpp to set error flag when a semantic error occurs
-    void setErrorFlag() { hasError = true; }
-};
-
-#endif
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "parser.h"
+using namespace std;
+
+// Represents an entry in the symbol table
+struct Symbol {
+    SymbolId name;
+    ValueType type;
+    uint32_t scope;       // index into SymbolTable::scopes
+    SymbolId var;         // TAC variable of this declaration (see AST::binding)
+};
+
+// Block-scoped symbol table.
+// - Every name maps to its innermost visible declaration through an
+//   open-addressing table keyed by SymbolId.
+// - Declaring a name logs the binding it hides; leaving a scope replays
+//   that log backwards, so entering/leaving a Block costs O(its declarations).
+// - Every declaration is kept (with its scope) so all scopes can be dumped.
+class SymbolTable {
+public:
+    struct Scope {
+        uint32_t depth;   // 1 = outermost block
+        size_t undoMark;  // undo log size when the scope was entered
+    };
+
+    SymbolTable();
+
+    void enterScope();
+    void leaveScope();
+
+    // Innermost visible declaration, nullptr if none
+    const Symbol *lookup(SymbolId name) const;
+    // Declared in the current scope already?
+    bool declaredHere(SymbolId name) const;
+    // Number of scopes currently entered (1 = outermost)
+    uint32_t depth() const { return (uint32_t)open.size(); }
+    void declare(SymbolId name, ValueType type, SymbolId var);
+
+    // Scopes in the order they were entered, and every declaration
+    const vector<Scope> &allScopes() const { return scopes; }
+    const vector<Symbol> &allSymbols() const { return symbols; }
+
+private:
+    static constexpr uint32_t UNBOUND = UINT32_MAX;
+
+    struct Slot {
+        SymbolId name;    // 0 = free
+        uint32_t binding; // index into symbols, or UNBOUND
+    };
+    struct Undo {
+        SymbolId name;
+        uint32_t previous;
+    };
+
+    vector<Slot> slots;   // power-of-two size, linear probing
+    size_t used = 0;
+    vector<Symbol> symbols;
+    vector<Scope> scopes;
+    vector<uint32_t> open;  // indices of the scopes currently entered
+    vector<Undo> undo;
+
+    size_t find(SymbolId name) const;   // its slot, or the free slot to use
+    void grow();
+};
+
+// The top-level declaration of main a name refers to from some statement
+// (nullptr if none is visible there); see analyzeStatement
+using OuterScope = function<const Symbol *(SymbolId)>;
+
+// What analyzing one top-level statement of main on its own produced
+struct StatementSemantics {
+    string messages;                  // its diagnostics, in order
+    bool hasError = false;
+    vector<Symbol> declared;          // its declarations in the top-level scope
+    // Every name it looked up in the OuterScope, with what it found (type
+    // Unknown: nothing). The result holds while each still resolves the same.
+    vector<Symbol> resolved;
+};
+
+// Semantic Analyzer class: performs symbol checks, type checks, etc.
+class SemanticAnalyzer {
+private:
+    SymbolTable symbolTable;          // variables, by block scope
+    bool hasError = false;            // flag for semantic errors
+    AST *ast = nullptr;               // tree being analyzed
+    bool listing;                     // banner, symbol table and summary
+    const OuterScope *outer = nullptr;        // analyzeStatement only
+    StatementSemantics *unit = nullptr;       // where its results go
+
+    // Internal helper functions
+    void analyzeNode(NodeId node);
+    ValueType nodeType(NodeId node);
+    const Symbol *lookup(SymbolId name);
+    void report(const string &msg);
+
+    unordered_map<SymbolId, uint32_t> declarations;   // declarations seen per name
+    SymbolId variableFor(SymbolId name);
+
+public:
+    // Without the listing only the diagnostics are printed (--jit, --run,
+    // --watch)
+    explicit SemanticAnalyzer(bool listing = true) : listing(listing) {}
+
+    // Run semantic analysis on the AST; every node gets its type
+    // (AST::type) in the same pass
+    void analyze(AST &tree);
+
+    // Analyze one top-level statement of main's body alone (--watch):
+    // names it does not declare itself are looked up in `scope`, which
+    // sees the top-level declarations before it. Nothing is printed; the messages
+    // and everything the result depends on go to `out`.
+    void analyzeStatement(AST &tree, NodeId stmt, const OuterScope &scope,
+                          StatementSemantics &out);
+
+    // Query: did we encounter semantic errors?
+    bool hasErrors() const { return hasError; }
+
+    // Print every scope's variables (nested blocks indented below)
+    void printSymbolTable() const;
+
+    // Allow semantic.cpp to set error flag when a semantic error occurs
+    void setErrorFlag() { hasError = true; }
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "source.h"
+#include <cstdint>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCE_HAVE_MMAP 1
+#endif
+
+using namespace std;
+
+SourceInput::~SourceInput() {
+    close();
+}
+
+void SourceInput::close() {
+#ifdef SOURCE_HAVE_MMAP
+    if (mapped && mapSize > 0)
+        munmap((void *)mapData, mapSize);
+#endif
+    mapped = false;
+    mapData = nullptr;
+    mapSize = 0;
+    if (stream && ownsStream) fclose(stream);
+    stream = nullptr;
+    ownsStream = false;
+}
+
+bool SourceInput::open(const string &path) {
+    close();
+
+    if (path == "-") {
+        stream = stdin;
+        return true;
+    }
+
+#ifdef SOURCE_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    // Token offsets are 32-bit, so only files below 4 GiB are mapped;
+    // anything larger (and anything that is not a regular file) is streamed.
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+        (uint64_t)st.st_size < UINT32_MAX) {
+        if (st.st_size == 0) {
+            ::close(fd);
+            mapped = true;
+            mapData = "";
+            return true;
+        }
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            ::close(fd);
+#ifdef MADV_SEQUENTIAL
+            madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+            mapped = true;
+            mapData = (const char *)p;
+            mapSize = (size_t)st.st_size;
+            return true;
+        }
+    }
+
+    stream = fdopen(fd, "rb");
+    if (!stream) {
+        ::close(fd);
+        return false;
+    }
+#else
+    stream = fopen(path.c_str(), "rb");
+    if (!stream) return false;
+#endif
+    ownsStream = true;
+    return true;
+}
+
+size_t SourceInput::read(char *dst, size_t cap) {
+    if (!stream) return 0;
+    return fread(dst, 1, cap, stream);
+}
@@ -0,0 +1,44 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Read-only view of a source file.
+// - Regular files are memory-mapped (POSIX) so the lexer scans the file
+//   bytes in place, without copying them into a std::string.
+// - Pipes, stdin ("-") and files that cannot be mapped are streamed in
+//   fixed-size chunks through read(), so memory does not grow with input size.
+//   The input is read once, front to back.
+class SourceInput {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    SourceInput() {}
+    ~SourceInput();
+    SourceInput(const SourceInput &) = delete;
+    SourceInput &operator=(const SourceInput &) = delete;
+
+    // Open a file ("-" = stdin). Returns false if it cannot be opened.
+    bool open(const std::string &path);
+
+    // Mapped mode: the whole file is available through data()/size()
+    bool isMapped() const { return mapped; }
+    const char *data() const { return mapData; }
+    size_t size() const { return mapSize; }
+
+    // Streaming mode: copy up to `cap` further bytes into dst, 0 at end of input
+    size_t read(char *dst, size_t cap);
+
+private:
+    bool mapped = false;
+    const char *mapData = nullptr;
+    size_t mapSize = 0;
+    FILE *stream = nullptr;
+    bool ownsStream = false;
+
+    void close();
+};
+
+#endif // SOURCE_H
@@ -0,0 +1,135 @@
+#include "ssa.h"
+#include <utility>
+
+using namespace std;
+
+SSAForm::SSAForm(const vector<Quad> &c, bool pruned)
+    : code(c), cfg(c), vars(c), idom(cfg.immediateDominators()) {
+    size_t n = code.size();
+    phis.assign(cfg.size(), {});
+    defValue.assign(n, NO_VALUE);
+    useA.assign(n, NO_VALUE);
+    useB.assign(n, NO_VALUE);
+    for (uint32_t v = 0; v < vars.size(); ++v) values.push_back({v, -1, 0});
+
+    placePhis(pruned);
+    rename();
+}
+
+// Phis go on the iterated dominance frontier of each variable's
+// assignments (when pruned, only where the variable is live on entry)
+void SSAForm::placePhis(bool pruned) {
+    size_t nb = cfg.size();
+
+    // Dominance frontiers: walk up from each predecessor of a merge block
+    // to its immediate dominator
+    vector<vector<uint32_t>> frontier(nb);
+    for (uint32_t b = 0; b < nb; ++b) {
+        if (idom[b] < 0 || cfg.blocks[b].preds.size() < 2) continue;
+        for (uint32_t p : cfg.blocks[b].preds) {
+            if (idom[p] < 0) continue;
+            for (uint32_t r = p; r != (uint32_t)idom[b]; r = (uint32_t)idom[r]) {
+                if (!frontier[r].empty() && frontier[r].back() == b) break;
+                frontier[r].push_back(b);
+            }
+        }
+    }
+
+    vector<vector<uint32_t>> defBlocks(vars.size());
+    for (uint32_t i = 0; i < code.size(); ++i) {
+        int32_t v = assignsValue(code[i]) ? vars.of(code[i].dst) : -1;
+        uint32_t b = cfg.blockOf[i];
+        if (v < 0 || idom[b] < 0) continue;
+        if (defBlocks[v].empty() || defBlocks[v].back() != b) defBlocks[v].push_back(b);
+    }
+
+    DataflowResult live;
+    if (pruned) live = liveVariables(code, cfg, vars);
+    vector<uint32_t> hasPhi(nb, UINT32_MAX), inWork(nb, UINT32_MAX);
+    vector<uint32_t> work;
+    for (uint32_t v = 0; v < vars.size(); ++v) {
+        work.clear();
+        for (uint32_t b : defBlocks[v]) {
+            inWork[b] = v;
+            work.push_back(b);
+        }
+        while (!work.empty()) {
+            uint32_t b = work.back();
+            work.pop_back();
+            for (uint32_t f : frontier[b]) {
+                if (hasPhi[f] == v || (pruned && !live.in[f].test(v))) continue;
+                hasPhi[f] = v;
+                phis[f].push_back({v, (uint32_t)values.size(),
+                                   vector<uint32_t>(cfg.blocks[f].preds.size(), NO_VALUE)});
+                values.push_back({v, -1, f});
+                if (inWork[f] != v) {
+                    inWork[f] = v;
+                    work.push_back(f);
+                }
+            }
+        }
+    }
+}
+
+// Walk the dominator tree keeping a stack of the current value of each
+// variable; a block's assignments are undone when its subtree is done
+void SSAForm::rename() {
+    size_t nb = cfg.size();
+    if (nb == 0) return;
+
+    vector<vector<uint32_t>> children(nb);
+    for (uint32_t b = 1; b < nb; ++b)
+        if (idom[b] >= 0) children[idom[b]].push_back(b);
+
+    vector<vector<uint32_t>> current(vars.size());
+    for (uint32_t v = 0; v < vars.size(); ++v) current[v].push_back(v);
+    vector<uint32_t> pushed;     // variables whose stack grew, in order
+
+    auto define = [&](uint32_t v, uint32_t value) {
+        current[v].push_back(value);
+        pushed.push_back(v);
+    };
+    auto read = [&](const Operand &o) {
+        int32_t v = vars.of(o);
+        return v < 0 ? NO_VALUE : current[v].back();
+    };
+
+    // (block, next child, size of `pushed` on entry)
+    struct Frame { uint32_t block; size_t child; size_t mark; };
+    vector<Frame> stack;
+    auto enter = [&](uint32_t b) {
+        stack.push_back({b, 0, pushed.size()});
+        for (Phi &phi : phis[b]) define(phi.var, phi.value);
+        for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].last; ++i) {
+            const Quad &q = code[i];
+            useA[i] = read(q.a);
+            useB[i] = read(q.b);
+            int32_t v = assignsValue(q) ? vars.of(q.dst) : -1;
+            if (v < 0) continue;
+            defValue[i] = (uint32_t)values.size();
+            values.push_back({(uint32_t)v, (int32_t)i, b});
+            define((uint32_t)v, defValue[i]);
+        }
+        for (uint32_t s : cfg.blocks[b].succs) {
+            const vector<uint32_t> &preds = cfg.blocks[s].preds;
+            for (size_t k = 0; k < preds.size(); ++k) {
+                if (preds[k] != b) continue;
+                for (Phi &phi : phis[s]) phi.args[k] = current[phi.var].back();
+            }
+        }
+    };
+
+    enter(0);
+    while (!stack.empty()) {
+        Frame &f = stack.back();
+        if (f.child < children[f.block].size()) {
+            enter(children[f.block][f.child++]);
+            continue;
+        }
+        while (pushed.size() > f.mark) {
+            current[pushed.back()].pop_back();
+            pushed.pop_back();
+        }
+        stack.pop_back();
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SSA_H
+#define SSA_H
+
+#include <cstdint>
+#include <vector>
+#include "tac.h"
+#include "cfg.h"
+#include "dataflow.h"
+
+// Static single assignment view of a TAC function.
+// - Every assignment of a variable or temporary defines a new value and
+//   every read is mapped to the one value that reaches it.
+// - Phis sit at the merge points (the labels ending an if/else) and are
+//   placed only where the variable is live (pruned SSA) unless a pass
+//   asks for every merge point (minimal SSA).
+// - The code itself is not renamed, so the versions of a variable never
+//   overlap: leaving SSA coalesces each phi web back into its variable
+//   and needs no copies, as long as passes only replace reads with
+//   constants or with values that are still available.
+constexpr uint32_t NO_VALUE = UINT32_MAX;
+
+struct Phi {
+    uint32_t var;                     // OperandIndex bit of the variable
+    uint32_t value;                   // value the phi defines
+    std::vector<uint32_t> args;       // one per predecessor, in preds order
+};
+
+struct SSAValue {
+    uint32_t var;
+    int32_t instr;                    // defining instruction, -1: phi or entry
+    uint32_t block;
+};
+
+class SSAForm {
+public:
+    explicit SSAForm(const std::vector<Quad> &code, bool pruned = true);
+
+    const std::vector<Quad> &code;
+    CFG cfg;
+    OperandIndex vars;
+    std::vector<int32_t> idom;                // immediate dominators
+    std::vector<std::vector<Phi>> phis;       // per block
+    // Values 0 .. vars.size()-1 are each variable's (undefined) value on
+    // entry; the rest are defined by instructions and phis
+    std::vector<SSAValue> values;
+    std::vector<uint32_t> defValue;           // instruction -> value it defines
+    std::vector<uint32_t> useA, useB;         // instruction -> value read by a / b
+
+    // Value read by operand slot 1 (a) or 2 (b); NO_VALUE if the operand is
+    // not a variable/temp or the instruction is unreachable
+    uint32_t useValue(uint32_t instr, int slot) const {
+        return slot == 1 ? useA[instr] : useB[instr];
+    }
+
+private:
+    void placePhis(bool pruned);
+    void rename();
+};
+
+#endif // SSA_H
@@ -0,0 +1,140 @@
+#include "tac.h"
+#include <charconv>
+
+using namespace std;
+
+bool Operand::operator==(const Operand &o) const {
+    if (kind != o.kind) return false;
+    switch (kind) {
+        case OperandKind::None:  return true;
+        case OperandKind::Int:   return i == o.i;
+        case OperandKind::Float: return f == o.f;
+        default:                 return id == o.id;
+    }
+}
+
+Opcode binaryOpcode(TokenId id) {
+    switch (id) {
+        case TokenId::Plus:  case TokenId::PlusAssign:  return Opcode::Add;
+        case TokenId::Minus: case TokenId::MinusAssign: return Opcode::Sub;
+        case TokenId::Star:  case TokenId::StarAssign:  return Opcode::Mul;
+        case TokenId::Slash: case TokenId::SlashAssign: return Opcode::Div;
+        case TokenId::Less:      return Opcode::Lt;
+        case TokenId::LessEq:    return Opcode::Le;
+        case TokenId::Greater:   return Opcode::Gt;
+        case TokenId::GreaterEq: return Opcode::Ge;
+        case TokenId::EqEq:      return Opcode::Eq;
+        case TokenId::NotEq:     return Opcode::Ne;
+        default:                 return Opcode::Copy;
+    }
+}
+
+const char *opcodeSpelling(Opcode op) {
+    switch (op) {
+        case Opcode::Add: return "+";
+        case Opcode::Sub: return "-";
+        case Opcode::Mul: return "*";
+        case Opcode::Div: return "/";
+        case Opcode::Lt:  return "<";
+        case Opcode::Le:  return "<=";
+        case Opcode::Gt:  return ">";
+        case Opcode::Ge:  return ">=";
+        case Opcode::Eq:  return "==";
+        case Opcode::Ne:  return "!=";
+        default:          return "";
+    }
+}
+
+int64_t truncateToInt(double v) {
+    return (v >= -9223372036854775808.0 && v < 9223372036854775808.0) ? (int64_t)v : INT64_MIN;
+}
+
+Operand convertFor(const Operand &dst, const Operand &c) {
+    if (c.kind == OperandKind::Int && dst.isDouble()) return Operand::real((double)c.i);
+    if (c.kind == OperandKind::Float && !dst.isDouble()) return Operand::integer(truncateToInt(c.f));
+    return c;
+}
+
+string formatOperand(const Operand &o) {
+    switch (o.kind) {
+        case OperandKind::None:  return "";
+        // '%' keeps a temp apart from a variable spelled the same way
+        case OperandKind::Temp:  return "%t" + to_string(o.id);
+        case OperandKind::Label: return "L" + to_string(o.id);
+        case OperandKind::Var:   return string(symbolNames().str(o.id));
+        case OperandKind::Int:   return to_string(o.i);
+        case OperandKind::Float: {
+            // shortest text that reads back as the same double; a float
+            // always shows a '.' so it cannot be mistaken for an int
+            char buf[64];
+            char *end = to_chars(buf, buf + sizeof buf, o.f).ptr;
+            string s(buf, end);
+            if (s.find_first_of(".eni") == string::npos) s += ".0";
+            return s;
+        }
+    }
+    return "";
+}
+
+string formatQuad(const Quad &q) {
+    switch (q.op) {
+        case Opcode::Copy:
+            return formatOperand(q.dst) + " = " + formatOperand(q.a);
+        case Opcode::Label:
+            return formatOperand(q.a) + ":";
+        case Opcode::Goto:
+            return "goto " + formatOperand(q.a);
+        case Opcode::IfGoto:
+            return "if " + formatOperand(q.a) + " goto " + formatOperand(q.b);
+        case Opcode::IfFalseGoto:
+            return "ifFalse " + formatOperand(q.a) + " goto " + formatOperand(q.b);
+        case Opcode::Return:
+            return "return " + formatOperand(q.a);
+        default:
+            return formatOperand(q.dst) + " = " + formatOperand(q.a) + " " +
+                   opcodeSpelling(q.op) + " " + formatOperand(q.b);
+    }
+}
+
+bool foldBinary(Opcode op, const Operand &a, const Operand &b, Operand &out) {
+    if (!a.isConst() || !b.isConst()) return false;
+    if (a.kind == OperandKind::Float || b.kind == OperandKind::Float) {
+        double da = (a.kind == OperandKind::Float) ? a.f : (double)a.i;
+        double db = (b.kind == OperandKind::Float) ? b.f : (double)b.i;
+        switch (op) {
+            case Opcode::Add: out = Operand::real(da + db); return true;
+            case Opcode::Sub: out = Operand::real(da - db); return true;
+            case Opcode::Mul: out = Operand::real(da * db); return true;
+            case Opcode::Div:
+                if (db == 0) return false;
+                out = Operand::real(da / db);
+                return true;
+            case Opcode::Lt: out = Operand::integer(da < db); return true;
+            case Opcode::Le: out = Operand::integer(da <= db); return true;
+            case Opcode::Gt: out = Operand::integer(da > db); return true;
+            case Opcode::Ge: out = Operand::integer(da >= db); return true;
+            case Opcode::Eq: out = Operand::integer(da == db); return true;
+            case Opcode::Ne: out = Operand::integer(da != db); return true;
+            default: return false;
+        }
+    }
+
+    // integers wrap around like the target's 64-bit registers
+    int64_t ia = a.i, ib = b.i;
+    switch (op) {
+        case Opcode::Add: out = Operand::integer((int64_t)((uint64_t)ia + (uint64_t)ib)); return true;
+        case Opcode::Sub: out = Operand::integer((int64_t)((uint64_t)ia - (uint64_t)ib)); return true;
+        case Opcode::Mul: out = Operand::integer((int64_t)((uint64_t)ia * (uint64_t)ib)); return true;
+        case Opcode::Div:
+            if (ib == 0 || (ia == INT64_MIN && ib == -1)) return false;
+            out = Operand::integer(ia / ib);
+            return true;
+        case Opcode::Lt: out = Operand::integer(ia < ib); return true;
+        case Opcode::Le: out = Operand::integer(ia <= ib); return true;
+        case Opcode::Gt: out = Operand::integer(ia > ib); return true;
+        case Opcode::Ge: out = Operand::integer(ia >= ib); return true;
+        case Opcode::Eq: out = Operand::integer(ia == ib); return true;
+        case Opcode::Ne: out = Operand::integer(ia != ib); return true;
+        default: return false;
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef TAC_H
+#define TAC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "token.h"
+
+// Three-address code. Every instruction is a Quad with an opcode and up to
+// three typed operands (temporaries, variables and labels are ids,
+// constants are decoded values); text is produced only for printing.
+//
+// Every temp and variable holds an integer or a double, fixed when it is
+// made: a variable's declared type, a temp's expression type. An
+// operation is done in double when either operand is one (integers wrap
+// at 64 bits, comparisons give an integer 0/1), and its result is
+// converted to the destination's type when it is stored: a double stored
+// into an integer truncates toward zero, an integer stored into a double
+// widens. The function returns an int, so return converts too.
+
+enum class Opcode : uint8_t {
+    Copy,                     // dst = a
+    Add, Sub, Mul, Div,       // dst = a op b
+    Lt, Le, Gt, Ge, Eq, Ne,   // dst = a op b (1 or 0)
+    Label,                    // a:
+    Goto,                     // goto a
+    IfGoto,                   // if a goto b
+    IfFalseGoto,              // ifFalse a goto b
+    Return                    // return a
+};
+
+enum class OperandKind : uint8_t { None, Temp, Var, Int, Float, Label };
+
+struct Operand {
+    OperandKind kind = OperandKind::None;
+    bool floating = false;    // Temp / Var: holds a double
+    union {
+        uint32_t id = 0;      // Temp: %tN, Label: LN, Var: SymbolId
+        int64_t i;            // Int
+        double f;             // Float
+    };
+
+    static Operand temp(uint32_t n, bool floating = false) {
+        Operand o; o.kind = OperandKind::Temp; o.floating = floating; o.id = n; return o;
+    }
+    static Operand var(SymbolId name, bool floating = false) {
+        Operand o; o.kind = OperandKind::Var; o.floating = floating; o.id = name; return o;
+    }
+    static Operand label(uint32_t n) { Operand o; o.kind = OperandKind::Label; o.id = n; return o; }
+    static Operand integer(int64_t v) { Operand o; o.kind = OperandKind::Int; o.i = v; return o; }
+    static Operand real(double v) { Operand o; o.kind = OperandKind::Float; o.f = v; return o; }
+    static Operand constant(const Number &n) { return n.isFloat ? real(n.f) : integer(n.i); }
+
+    bool isTemp() const { return kind == OperandKind::Temp; }
+    bool isConst() const { return kind == OperandKind::Int || kind == OperandKind::Float; }
+    bool isInt(int64_t v) const { return kind == OperandKind::Int && i == v; }
+    // A double constant, or a temp / variable holding doubles
+    bool isDouble() const { return kind == OperandKind::Float || floating; }
+
+    bool operator==(const Operand &o) const;
+    bool operator!=(const Operand &o) const { return !(*this == o); }
+};
+
+struct Quad {
+    Opcode op;
+    Operand dst, a, b;
+};
+
+// Binary arithmetic or relational opcode?
+inline bool isBinary(Opcode op) { return op >= Opcode::Add && op <= Opcode::Ne; }
+inline bool isRelational(Opcode op) { return op >= Opcode::Lt && op <= Opcode::Ne; }
+// if / ifFalse: condition in a, target label in b
+inline bool isCondJump(Opcode op) { return op == Opcode::IfGoto || op == Opcode::IfFalseGoto; }
+
+// Is "a op b" computed (and its exact result a value) in double?
+inline bool resultIsDouble(const Quad &q) {
+    return !isRelational(q.op) && (q.a.isDouble() || q.b.isDouble());
+}
+
+// Does storing the result of a copy or binary q into its dst convert it?
+inline bool convertsOnStore(const Quad &q) {
+    return q.dst.isDouble() != (q.op == Opcode::Copy ? q.a.isDouble() : resultIsDouble(q));
+}
+
+// Can q fault? An integer division by anything but a known nonzero
+// constant can (division by zero), so it is kept even when its result is
+// never read; a double division gives inf or NaN instead
+inline bool mayFault(const Quad &q) {
+    return q.op == Opcode::Div && !resultIsDouble(q) && !(q.b.kind == OperandKind::Int && q.b.i != 0);
+}
+
+// Does the conditional jump q branch when its condition is the constant c?
+inline bool jumpTaken(const Quad &q, const Operand &c) {
+    bool nonZero = (c.kind == OperandKind::Float) ? c.f != 0 : c.i != 0;
+    return nonZero == (q.op == Opcode::IfGoto);
+}
+
+// Opcode of a binary operator token (+, <=, ...; += maps to +)
+Opcode binaryOpcode(TokenId id);
+const char *opcodeSpelling(Opcode op);    // "+", "<=", ...
+
+// Value of "a op b" for two constants (integers wrap around); false when
+// an operand is not constant or the result is undefined (x / 0, ...)
+bool foldBinary(Opcode op, const Operand &a, const Operand &b, Operand &out);
+
+// What cvttsd2si gives: out of range and NaN become INT64_MIN
+int64_t truncateToInt(double v);
+// The constant c as stored into `dst` (converted to its type); any other
+// operand is returned unchanged
+Operand convertFor(const Operand &dst, const Operand &c);
+
+// Text form, e.g. "%t3 = a + b", "if %t1 goto L1", "L2:"
+std::string formatOperand(const Operand &o);
+std::string formatQuad(const Quad &q);
+
+#endif // TAC_H
@@ -1,12 +1,80 @@
-#ifndef TOKEN_H
-#define TOKEN_H
-
-#include <string>
-
-// Simple token struct used by lexer & parser
-struct Token {
-    std::string type;   // e.g. "KEYWORD", "IDENTIFIER", "NUMBER", "OPERATOR", "SYMBOL"
-    std::string value;  // actual lexeme
-};
-
-#endif // TOKEN_H
+#ifndef TOKEN_H
+#define TOKEN_H
+
+#include <cstdint>
+#include "intern.h"
+
+// Token category
+enum class TokenKind : uint8_t {
+    Keyword,
+    Identifier,
+    Number,
+    String,
+    Operator,
+    Symbol,
+    Unknown,
+    Eof
+};
+
+// Pre-classified keyword / operator / symbol id (None for names, literals, ...)
+enum class TokenId : uint8_t {
+    None,
+
+    // keywords
+    KwInt, KwFloat, KwIf, KwElse, KwWhile, KwReturn, KwFor, KwMain,
+
+    // operators
+    Plus, Minus, Star, Slash, Assign, Less, Greater, Not,
+    EqEq, NotEq, LessEq, GreaterEq,
+    PlusAssign, MinusAssign, StarAssign, SlashAssign,
+
+    // symbols
+    Semi, Comma, LBrace, RBrace, LParen, RParen
+};
+
+// Value of a numeric literal, decoded once by the lexer: "42" is the
+// integer 42, anything with a '.' is a double
+struct Number {
+    bool isFloat = false;
+    union {
+        int64_t i = 0;
+        double f;
+    };
+
+    static Number ofInt(int64_t v) { Number n; n.i = v; return n; }
+    static Number ofFloat(double v) { Number n; n.isFloat = true; n.f = v; return n; }
+    double toDouble() const { return isFloat ? f : (double)i; }
+};
+
+// Names are interned once, when they are lexed, into one table shared by
+// every phase; later phases key their tables by these dense ids. The
+// spelling of each TokenId is interned first, so its symbol id equals the
+// TokenId (and 0 is the empty string).
+using SymbolId = uint32_t;
+StringInterner &symbolNames();    // defined in lexer.cpp
+
+// Compact token: the lexeme is not copied, it is the range
+// [offset, offset + length) of the source buffer owned by the Lexer.
+// Number tokens also carry their decoded value.
+struct Token {
+    TokenKind kind = TokenKind::Eof;
+    TokenId id = TokenId::None;
+    bool isFloat = false;         // Number: value is floatValue
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    SymbolId sym = 0;             // Identifier: interned name; Keyword/Operator/Symbol: id
+    union {
+        int64_t intValue = 0;
+        double floatValue;
+    };
+
+    Number number() const {
+        return isFloat ? Number::ofFloat(floatValue) : Number::ofInt(intValue);
+    }
+};
+
+// Printable names, e.g. "KEYWORD" / "(" (defined in lexer.cpp)
+const char *tokenKindName(TokenKind kind);
+const char *tokenIdSpelling(TokenId id);
+
+#endif // TOKEN_H
@@ -0,0 +1,314 @@
+#include "vm.h"
+#include "dataflow.h"
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_THREADED
+#endif
+
+using namespace std;
+
+// -----------------------------
+// TAC -> bytecode
+// -----------------------------
+Bytecode compileBytecode(const vector<Quad> &tac) {
+    Bytecode bc;
+    OperandIndex vars(tac);
+    // scratch registers after the temps and variables: the two operands
+    // widened for a double operation, and a result still to be converted
+    const uint32_t widenA = (uint32_t)vars.size(), widenB = widenA + 1, unconverted = widenA + 2;
+    bc.values = widenA + 3;
+
+    // one register per distinct constant (keyed by type and bits)
+    unordered_map<uint64_t, uint32_t> intRegs, floatRegs;
+    auto constant = [&](bool isFloat, uint64_t bits) {
+        auto &regs = isFloat ? floatRegs : intRegs;
+        auto it = regs.find(bits);
+        if (it != regs.end()) return it->second;
+        VMValue v;
+        v.i = (int64_t)bits;
+        uint32_t r = bc.values + (uint32_t)bc.constants.size();
+        bc.constants.push_back(v);
+        regs.emplace(bits, r);
+        return r;
+    };
+    // A temp's or variable's register; a constant's, in the type asked for
+    auto reg = [&](const Operand &o, bool asDouble) -> uint32_t {
+        int32_t v = vars.of(o);
+        if (v >= 0) return (uint32_t)v;
+        Operand c = convertFor(Operand::temp(0, asDouble), o.isConst() ? o : Operand::integer(0));
+        uint64_t bits;
+        memcpy(&bits, &c.i, sizeof bits);
+        return constant(asDouble, bits);
+    };
+    auto emit = [&](BcOp op, initializer_list<uint32_t> operands) {
+        bc.code.push_back((uint32_t)op);
+        bc.code.insert(bc.code.end(), operands);
+    };
+    // Register holding o as a double / an integer: a temp or variable of
+    // the other type is converted into `scratch` first
+    auto operand = [&](const Operand &o, bool asDouble, uint32_t scratch) {
+        if (vars.of(o) < 0 || o.isDouble() == asDouble) return reg(o, asDouble);
+        emit(asDouble ? BcOp::IntToFloat : BcOp::FloatToInt, {scratch, reg(o, !asDouble)});
+        return scratch;
+    };
+
+    for (const Quad &q : tac) {
+        switch (q.op) {
+            case Opcode::Label:
+                if (q.a.id >= bc.labels.size()) bc.labels.resize(q.a.id + 1, UINT32_MAX);
+                bc.labels[q.a.id] = (uint32_t)bc.code.size();
+                break;
+            case Opcode::Goto:
+                emit(BcOp::Goto, {q.a.id});
+                break;
+            case Opcode::IfGoto:
+            case Opcode::IfFalseGoto: {
+                bool d = q.a.isDouble();
+                BcOp op = q.op == Opcode::IfGoto ? (d ? BcOp::IfGotoF : BcOp::IfGotoI)
+                                                 : (d ? BcOp::IfFalseGotoF : BcOp::IfFalseGotoI);
+                emit(op, {reg(q.a, d), q.b.id});
+                break;
+            }
+            case Opcode::Return:
+                // the function returns an int
+                emit(BcOp::Return, {operand(q.a, false, widenA)});
+                break;
+            case Opcode::Copy: {
+                bool d = q.dst.isDouble();
+                if (vars.of(q.a) >= 0 && q.a.isDouble() != d)
+                    emit(d ? BcOp::IntToFloat : BcOp::FloatToInt, {reg(q.dst, d), reg(q.a, !d)});
+                else
+                    emit(BcOp::Copy, {reg(q.dst, d), reg(q.a, d)});
+                break;
+            }
+            default: {
+                // done in double if either operand is one, then stored
+                // converted to the destination's type
+                bool d = q.a.isDouble() || q.b.isDouble();
+                uint32_t a = operand(q.a, d, widenA), b = operand(q.b, d, widenB);
+                bool resultDouble = d && !isRelational(q.op);
+                bool convert = q.dst.isDouble() != resultDouble;
+                uint32_t out = convert ? unconverted : reg(q.dst, resultDouble);
+                // Add..Ne line up with AddI..NeI and AddF..NeF
+                BcOp first = d ? BcOp::AddF : BcOp::AddI;
+                emit((BcOp)((int)first + ((int)q.op - (int)Opcode::Add)), {out, a, b});
+                if (convert)
+                    emit(resultDouble ? BcOp::FloatToInt : BcOp::IntToFloat, {reg(q.dst, !resultDouble), out});
+                break;
+            }
+        }
+    }
+    emit(BcOp::Return, {reg(Operand(), false)});
+    return bc;
+}
+
+// -----------------------------
+// Interpreter
+// -----------------------------
+namespace {
+
+using Slot = VM::Slot;
+
+// Operand words after the opcode, and which of them is a label
+int operandCount(BcOp op) {
+    switch (op) {
+        case BcOp::Copy: case BcOp::IntToFloat: case BcOp::FloatToInt:
+        case BcOp::IfGotoI: case BcOp::IfFalseGotoI: case BcOp::IfGotoF: case BcOp::IfFalseGotoF:
+            return 2;
+        case BcOp::Goto: case BcOp::Return: return 1;
+        default: return 3;
+    }
+}
+
+int labelOperand(BcOp op) {
+    if (op == BcOp::Goto) return 0;
+    if (op >= BcOp::IfGotoI && op <= BcOp::IfFalseGotoF) return 1;
+    return -1;
+}
+
+enum class Exit { Returned, DivByZero };
+
+// Runs from pc until a Return. With pc == nullptr it only hands out the
+// handler table (the addresses of labels exist only in here).
+Exit execute(const Slot *pc, uint64_t &dispatched, int64_t &out, const void *const **table) {
+    uint64_t count = 0;
+
+#ifdef VM_THREADED
+#define CASE(name) op_##name:
+#define NEXT() do { ++count; goto *(pc++)->handler; } while (0)
+    // in BcOp order
+    static const void *const handlers[] = {
+        &&op_Copy, &&op_IntToFloat, &&op_FloatToInt,
+        &&op_AddI, &&op_SubI, &&op_MulI, &&op_DivI,
+        &&op_LtI, &&op_LeI, &&op_GtI, &&op_GeI, &&op_EqI, &&op_NeI,
+        &&op_AddF, &&op_SubF, &&op_MulF, &&op_DivF,
+        &&op_LtF, &&op_LeF, &&op_GtF, &&op_GeF, &&op_EqF, &&op_NeF,
+        &&op_Goto, &&op_IfGotoI, &&op_IfFalseGotoI, &&op_IfGotoF, &&op_IfFalseGotoF,
+        &&op_Return
+    };
+    if (!pc) {
+        *table = handlers;
+        return Exit::Returned;
+    }
+    NEXT();
+    {
+#else
+#define CASE(name) case BcOp::name:
+#define NEXT() continue
+    (void)table;
+    if (!pc) return Exit::Returned;
+    for (;;) {
+        ++count;
+        switch ((BcOp)(pc++)->op) {
+#endif
+
+#define INT_ARITH(name, OP)                                                    \
+    CASE(name) {                                                               \
+        pc[0].reg->i = (int64_t)((uint64_t)pc[1].reg->i OP (uint64_t)pc[2].reg->i); \
+        pc += 3;                                                               \
+        NEXT();                                                                \
+    }
+#define COMPARE(name, OP, FIELD)                                               \
+    CASE(name) {                                                               \
+        pc[0].reg->i = pc[1].reg->FIELD OP pc[2].reg->FIELD;                   \
+        pc += 3;                                                               \
+        NEXT();                                                                \
+    }
+#define FLOAT_ARITH(name, OP)                                                  \
+    CASE(name) {                                                               \
+        pc[0].reg->f = pc[1].reg->f OP pc[2].reg->f;                           \
+        pc += 3;                                                               \
+        NEXT();                                                                \
+    }
+
+        CASE(Copy) {
+            *pc[0].reg = *pc[1].reg;
+            pc += 2;
+            NEXT();
+        }
+        CASE(IntToFloat) {
+            pc[0].reg->f = (double)pc[1].reg->i;
+            pc += 2;
+            NEXT();
+        }
+        CASE(FloatToInt) {
+            pc[0].reg->i = truncateToInt(pc[1].reg->f);
+            pc += 2;
+            NEXT();
+        }
+        INT_ARITH(AddI, +)
+        INT_ARITH(SubI, -)
+        INT_ARITH(MulI, *)
+        CASE(DivI) {
+            int64_t a = pc[1].reg->i, b = pc[2].reg->i;
+            if (b == 0) {
+                dispatched = count;
+                return Exit::DivByZero;
+            }
+            // INT64_MIN / -1 wraps like the other integer operations
+            pc[0].reg->i = b == -1 ? (int64_t)(0 - (uint64_t)a) : a / b;
+            pc += 3;
+            NEXT();
+        }
+        COMPARE(LtI, <, i)
+        COMPARE(LeI, <=, i)
+        COMPARE(GtI, >, i)
+        COMPARE(GeI, >=, i)
+        COMPARE(EqI, ==, i)
+        COMPARE(NeI, !=, i)
+        FLOAT_ARITH(AddF, +)
+        FLOAT_ARITH(SubF, -)
+        FLOAT_ARITH(MulF, *)
+        FLOAT_ARITH(DivF, /)
+        COMPARE(LtF, <, f)
+        COMPARE(LeF, <=, f)
+        COMPARE(GtF, >, f)
+        COMPARE(GeF, >=, f)
+        COMPARE(EqF, ==, f)
+        COMPARE(NeF, !=, f)
+        CASE(Goto) {
+            pc = pc[0].target;
+            NEXT();
+        }
+        // a condition is true when it is not 0 (a NaN is true)
+        CASE(IfGotoI) {
+            pc = pc[0].reg->i != 0 ? pc[1].target : pc + 2;
+            NEXT();
+        }
+        CASE(IfFalseGotoI) {
+            pc = pc[0].reg->i != 0 ? pc + 2 : pc[1].target;
+            NEXT();
+        }
+        CASE(IfGotoF) {
+            pc = pc[0].reg->f != 0 ? pc[1].target : pc + 2;
+            NEXT();
+        }
+        CASE(IfFalseGotoF) {
+            pc = pc[0].reg->f != 0 ? pc + 2 : pc[1].target;
+            NEXT();
+        }
+        CASE(Return) {
+            out = pc[0].reg->i;
+            dispatched = count;
+            return Exit::Returned;
+        }
+
+#ifndef VM_THREADED
+        }
+#endif
+    }
+#undef INT_ARITH
+#undef FLOAT_ARITH
+#undef COMPARE
+#undef CASE
+#undef NEXT
+}
+
+} // namespace
+
+VM::VM(const Bytecode &bc) {
+    initial.resize(bc.values + bc.constants.size());
+    for (size_t k = 0; k < bc.constants.size(); ++k) initial[bc.values + k] = bc.constants[k];
+    regs = initial;
+
+#ifdef VM_THREADED
+    const void *const *handlers = nullptr;
+    uint64_t unused = 0;
+    int64_t none = 0;
+    execute(nullptr, unused, none, &handlers);
+#endif
+
+    code.resize(bc.code.size());
+    for (size_t at = 0; at < bc.code.size();) {
+        BcOp op = (BcOp)bc.code[at];
+#ifdef VM_THREADED
+        code[at].handler = handlers[(int)op];
+#else
+        code[at].op = (uint32_t)op;
+#endif
+        int operands = operandCount(op), label = labelOperand(op);
+        for (int k = 0; k < operands; ++k) {
+            uint32_t word = bc.code[at + 1 + k];
+            if (k == label) code[at + 1 + k].target = &code[bc.labels[word]];
+            else code[at + 1 + k].reg = &regs[word];
+        }
+        at += 1 + operands;
+    }
+}
+
+bool VM::run(VMResult &result, string &error) {
+    using Clock = chrono::steady_clock;
+    // registers are reset in place: the threaded code points at them
+    copy(initial.begin(), initial.end(), regs.begin());
+    Clock::time_point start = Clock::now();
+    Exit exit = execute(code.data(), result.dispatched, result.value, nullptr);
+    result.millis = chrono::duration<double, milli>(Clock::now() - start).count();
+    if (exit == Exit::DivByZero) {
+        error = "Runtime Error: integer division by zero";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "tac.h"
+
+// Bytecode for TAC and a register-based interpreter for it.
+// - Every temp and variable is a register; constants are registers too,
+//   preloaded when the program starts, so each operand is one word.
+// - Registers are untyped words: every temp and variable has the type
+//   the IR gives it (tac.h), so the compiler picks the integer or double
+//   form of each instruction and makes every conversion an instruction
+//   of its own (an int operand of a double operation is widened first,
+//   a store into a variable of the other type converts). Integers wrap
+//   around at 64 bits; comparisons give 0/1.
+// - Jumps name labels; the loader resolves them once, so a jump at run
+//   time is a single pointer move.
+// - With GCC/Clang the loaded code is direct-threaded (each instruction
+//   starts with the address of its handler, computed goto); elsewhere a
+//   switch over the opcode dispatches.
+
+enum class BcOp : uint8_t {
+    Copy,                              // dst a
+    IntToFloat, FloatToInt,            // dst a (FloatToInt truncates like cvttsd2si)
+    AddI, SubI, MulI, DivI,            // dst a b, integers
+    LtI, LeI, GtI, GeI, EqI, NeI,
+    AddF, SubF, MulF, DivF,            // dst a b, doubles
+    LtF, LeF, GtF, GeF, EqF, NeF,
+    Goto,                              // label
+    IfGotoI, IfFalseGotoI,             // cond label
+    IfGotoF, IfFalseGotoF,
+    Return                             // a (an integer)
+};
+
+union VMValue {
+    int64_t i = 0;
+    double f;
+};
+
+struct Bytecode {
+    std::vector<uint32_t> code;        // opcode word, then its operand words
+    uint32_t values = 0;               // registers 0..values-1: temps and variables,
+                                       // then the conversions' scratch registers
+    std::vector<VMValue> constants;    // registers values.. hold these
+    std::vector<uint32_t> labels;      // label id -> word offset in code
+};
+
+// TAC -> bytecode (labels become label-table entries; a final
+// "return 0" covers falling off the end)
+Bytecode compileBytecode(const std::vector<Quad> &tac);
+
+struct VMResult {
+    int64_t value = 0;                 // what the program returned
+    uint64_t dispatched = 0;           // instructions executed
+    double millis = 0;
+};
+
+class VM {
+public:
+    // Loads the program: threads the code and resolves every label
+    explicit VM(const Bytecode &bc);
+    VM(const VM &) = delete;              // the code points into `regs`
+    VM &operator=(const VM &) = delete;
+
+    // False, with a message, on a runtime error (integer division by zero)
+    bool run(VMResult &result, std::string &error);
+
+    union Slot {
+        const void *handler;           // threaded dispatch
+        uint32_t op;                   // switch dispatch
+        VMValue *reg;
+        const Slot *target;
+    };
+
+private:
+    std::vector<VMValue> initial;      // register file at program start
+    std::vector<VMValue> regs;
+    std::vector<Slot> code;
+};
+
+#endif // VM_H
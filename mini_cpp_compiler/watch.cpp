@@ -0,0 +1,645 @@
+#include "watch.h"
+#include <iostream>
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "icg.h"
+#include "opt.h"
+#include "codegen.h"
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+
+static bool readFile(const string &path, string &out) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// Byte range of a token in the source (string lexemes exclude their quotes)
+static size_t tokenStart(const Token &t) {
+    return t.offset - (t.kind == TokenKind::String ? 1 : 0);
+}
+
+static size_t tokenEnd(const Token &t) {
+    return t.offset + t.length + (t.kind == TokenKind::String ? 1 : 0);
+}
+
+// Same shape and values (both trees live in the same AST)
+static bool sameTree(const AST &t, NodeId a, NodeId b) {
+    vector<pair<NodeId, NodeId>> stack{{a, b}};
+    while (!stack.empty()) {
+        auto [x, y] = stack.back();
+        stack.pop_back();
+        if (x == NO_NODE || y == NO_NODE) {
+            if (x != y) return false;
+            continue;
+        }
+        if (t.kind(x) != t.kind(y) || t[x].value != t[y].value ||
+            t.numChildren(x) != t.numChildren(y))
+            return false;
+        for (size_t i = 0; i < t.numChildren(x); ++i)
+            stack.push_back({t.child(x, i), t.child(y, i)});
+    }
+    return true;
+}
+
+// -----------------------------
+// Incremental Back End
+// -----------------------------
+// Semantic analysis through codegen, one top-level statement of main at a
+// time. A statement's result depends on its own subtree and on the
+// top-level declarations its names resolved to, so it is redone only when
+// the statement was edited or one of those names now resolves differently.
+// A top-level redeclaration is an error, so each name has at most one
+// top-level declaration in force; the statements that resolved each name
+// are indexed, and a declaration that changes finds them directly.
+class IncrementalBackEnd {
+public:
+    void clear();
+    // A top-level statement is now the index-th of main's body
+    void place(NodeId stmt, uint32_t index);
+    // New or edited inside: compiled again at the next run
+    void edited(NodeId stmt) { dirty.insert(stmt); }
+    // No longer in main's body
+    void removed(NodeId stmt);
+    // Bring the results up to date; prints the diagnostics and totals
+    void run(AST &ast, NodeId body);
+
+private:
+    struct Result {
+        StatementSemantics semantics;
+        size_t tacBefore = 0, tacAfter = 0, machineInstrs = 0;
+    };
+    struct Declaration {
+        NodeId stmt;
+        Symbol symbol;
+    };
+
+    unordered_map<NodeId, Result> results;
+    vector<uint32_t> position;                            // index in main's body, by NodeId
+    unordered_map<SymbolId, Declaration> declarations;    // top-level declarations in force
+    unordered_map<SymbolId, unordered_set<NodeId>> readers;   // statements that resolved a name
+    unordered_set<NodeId> dirty;                          // edited since the last run
+    unordered_set<NodeId> failing;                        // results with semantic errors
+    vector<SymbolId> undeclared;                          // names whose statement was removed
+    size_t tacBefore = 0, tacAfter = 0, machineInstrs = 0;     // totals over the results
+
+    const Symbol *visible(SymbolId name, uint32_t at) const;
+    bool resolvesSame(const Result &r, uint32_t at) const;
+    Result compile(AST &ast, NodeId stmt, uint32_t at);
+    void index(NodeId stmt, const Result &r);
+    void unindex(NodeId stmt, const Result &r);
+};
+
+void IncrementalBackEnd::clear() {
+    results.clear();
+    declarations.clear();
+    readers.clear();
+    dirty.clear();
+    failing.clear();
+    undeclared.clear();
+    tacBefore = tacAfter = machineInstrs = 0;
+}
+
+void IncrementalBackEnd::place(NodeId stmt, uint32_t index) {
+    if (stmt >= position.size()) position.resize(stmt + 1);
+    position[stmt] = index;
+}
+
+void IncrementalBackEnd::removed(NodeId stmt) {
+    dirty.erase(stmt);
+    auto it = results.find(stmt);
+    if (it == results.end()) return;
+    for (const Symbol &sym : it->second.semantics.declared) undeclared.push_back(sym.name);
+    unindex(stmt, it->second);
+    results.erase(it);
+}
+
+// The top-level declaration of `name` a statement at index `at` sees
+const Symbol *IncrementalBackEnd::visible(SymbolId name, uint32_t at) const {
+    auto it = declarations.find(name);
+    if (it == declarations.end() || position[it->second.stmt] >= at) return nullptr;
+    return &it->second.symbol;
+}
+
+// Every outer name the result looked up still resolves the same way
+bool IncrementalBackEnd::resolvesSame(const Result &r, uint32_t at) const {
+    for (const Symbol &seen : r.semantics.resolved) {
+        const Symbol *now = visible(seen.name, at);
+        if (!now ? seen.type != ValueType::Unknown : now->type != seen.type || now->var != seen.var)
+            return false;
+    }
+    return true;
+}
+
+// Every phase for one statement alone. Its TAC is optimized as a fragment
+// (no constants or dead stores across statements), so the totals are
+// those of main compiled piecewise rather than as a whole.
+IncrementalBackEnd::Result IncrementalBackEnd::compile(AST &ast, NodeId stmt, uint32_t at) {
+    Result r;
+    SemanticAnalyzer semantic(false);
+    semantic.analyzeStatement(ast, stmt, [&](SymbolId name) { return visible(name, at); },
+                              r.semantics);
+    if (r.semantics.hasError) return r;
+
+    ICGGenerator icg;
+    icg.generate(ast, stmt);
+    vector<Quad> tac = icg.getCode();
+    r.tacBefore = tac.size();
+    optimizeFragment(tac);
+    r.tacAfter = tac.size();
+    CodeGen cg;
+    r.machineInstrs = cg.generate(tac).code.size();
+    return r;
+}
+
+void IncrementalBackEnd::index(NodeId stmt, const Result &r) {
+    for (const Symbol &seen : r.semantics.resolved) readers[seen.name].insert(stmt);
+    for (const Symbol &sym : r.semantics.declared) {
+        // the earliest declaration is the one in force
+        auto it = declarations.find(sym.name);
+        if (it == declarations.end() || position[it->second.stmt] > position[stmt])
+            declarations[sym.name] = {stmt, sym};
+    }
+    if (r.semantics.hasError) failing.insert(stmt);
+    tacBefore += r.tacBefore;
+    tacAfter += r.tacAfter;
+    machineInstrs += r.machineInstrs;
+}
+
+void IncrementalBackEnd::unindex(NodeId stmt, const Result &r) {
+    for (const Symbol &seen : r.semantics.resolved) {
+        auto it = readers.find(seen.name);
+        if (it == readers.end()) continue;
+        it->second.erase(stmt);
+        if (it->second.empty()) readers.erase(it);
+    }
+    for (const Symbol &sym : r.semantics.declared) {
+        auto it = declarations.find(sym.name);
+        if (it != declarations.end() && it->second.stmt == stmt) declarations.erase(it);
+    }
+    failing.erase(stmt);
+    tacBefore -= r.tacBefore;
+    tacAfter -= r.tacAfter;
+    machineInstrs -= r.machineInstrs;
+}
+
+// Statements are revisited in body order, so each sees the declarations
+// before it already settled. Only the diagnostics are shown, followed by
+// the totals and the time the run took.
+void IncrementalBackEnd::run(AST &ast, NodeId body) {
+    auto t0 = chrono::steady_clock::now();
+    size_t count = (body == NO_NODE) ? 0 : ast.numChildren(body);
+    using Work = pair<uint32_t, NodeId>;                  // (index in the body, statement)
+    priority_queue<Work, vector<Work>, greater<Work>> work;
+    auto visit = [&](NodeId stmt) {
+        if (stmt < position.size() && position[stmt] < count && ast.child(body, position[stmt]) == stmt)
+            work.push({position[stmt], stmt});
+    };
+    auto visitReaders = [&](SymbolId name, uint32_t from) {
+        auto it = readers.find(name);
+        if (it == readers.end()) return;
+        for (NodeId r : it->second)
+            if (position[r] >= from) visit(r);
+    };
+    for (NodeId stmt : dirty) visit(stmt);
+    for (SymbolId name : undeclared) visitReaders(name, 0);
+    undeclared.clear();
+
+    size_t recompiled = 0;
+    NodeId last = NO_NODE;
+    while (!work.empty()) {
+        auto [at, stmt] = work.top();
+        work.pop();
+        if (stmt == last) continue;
+        last = stmt;
+        auto it = results.find(stmt);
+        if (it != results.end() && !dirty.count(stmt) && resolvesSame(it->second, at)) continue;
+
+        Result fresh = compile(ast, stmt, at);
+        recompiled++;
+        vector<Symbol> before;
+        if (it != results.end()) {
+            before = it->second.semantics.declared;
+            unindex(stmt, it->second);
+        }
+        index(stmt, fresh);
+
+        // a declaration added, dropped or retyped: the readers after it
+        auto differs = [](const Symbol &sym, const vector<Symbol> &other) {
+            for (const Symbol &o : other)
+                if (o.name == sym.name) return o.type != sym.type;
+            return true;
+        };
+        for (const Symbol &sym : before)
+            if (differs(sym, fresh.semantics.declared)) visitReaders(sym.name, at + 1);
+        for (const Symbol &sym : fresh.semantics.declared)
+            if (differs(sym, before)) visitReaders(sym.name, at + 1);
+        results[stmt] = move(fresh);
+    }
+    dirty.clear();
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    if (!failing.empty()) {
+        vector<NodeId> order(failing.begin(), failing.end());
+        sort(order.begin(), order.end(), [&](NodeId a, NodeId b) { return position[a] < position[b]; });
+        for (NodeId stmt : order) cout << results[stmt].semantics.messages;
+        cout << "Compilation stopped due to semantic errors.\n";
+    } else {
+        cout << "[watch] TAC " << tacBefore << " lines (" << tacAfter << " optimized), "
+             << machineInstrs << " machine instructions; back end " << ms << " ms ("
+             << recompiled << " of " << count << " statements compiled)\n";
+    }
+}
+
+// -----------------------------
+// Watch Session
+// -----------------------------
+class WatchSession {
+public:
+    explicit WatchSession(const string &file) : path(file) {}
+
+    // Read the file again and bring every phase up to date
+    void rebuild();
+    void update(string &next);    // same, for new contents already read
+
+private:
+    enum Patch { PATCH_FAILED, PATCH_ERRORS, PATCH_SAME, PATCH_CHANGED };
+
+    string path;
+    string text;                  // source of the last build
+    vector<Token> tokens;         // its tokens (offsets into text)
+    AST ast;
+    vector<TokenSpan> spans;      // statement token ranges, by NodeId
+    vector<NodeId> parent;        // parent of every node (NO_NODE for the root)
+    bool patchable = false;       // last build had no lexical/syntax errors
+    size_t fullBuildNodes = 0;    // AST size right after the last full build
+    IncrementalBackEnd backEnd;   // patch() reports the statements it touched
+
+    bool fullBuild(string &next);
+    Patch patch(string &next, string &summary);
+    void linkParents(size_t from);
+    NodeId body() const;
+};
+
+void WatchSession::rebuild() {
+    string next;
+    if (!readFile(path, next)) {
+        cout << "[watch] cannot read " << path << "\n";
+        return;
+    }
+    update(next);
+}
+
+void WatchSession::update(string &next) {
+    auto t0 = chrono::steady_clock::now();
+
+    // Patched-out nodes stay in the arena, so rebuild from scratch once
+    // they outnumber the live ones
+    string summary;
+    Patch result = PATCH_FAILED;
+    if (patchable && ast.size() <= 2 * fullBuildNodes + 1024)
+        result = patch(next, summary);
+
+    if (result == PATCH_FAILED) {
+        summary.clear();
+        if (fullBuild(next)) {
+            summary = "full build: " + to_string(tokens.size()) + " tokens, " +
+                      to_string(ast.size()) + " AST nodes";
+            result = PATCH_CHANGED;
+        } else {
+            result = PATCH_ERRORS;
+        }
+    }
+    if (result == PATCH_CHANGED) backEnd.run(ast, body());
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    if (!summary.empty()) cout << "[watch] " << summary << "\n";
+    cout << "[watch] done in " << ms << " ms\n" << flush;
+}
+
+bool WatchSession::fullBuild(string &next) {
+    text.swap(next);
+    patchable = false;
+
+    Lexer lexer(text, 0);
+    tokens = lexer.tokenizeParallel();
+    if (lexer.hasErrors()) {
+        cout << "Compilation stopped due to lexical errors.\n";
+        return false;
+    }
+
+    ast.clear();
+    spans.clear();
+    backEnd.clear();
+    Parser parser(lexer, tokens.data(), tokens.data() + tokens.size(), ast);
+    parser.recordSpans(spans);
+    parser.parse();
+    if (parser.hasErrors()) {
+        cout << "Compilation stopped due to syntax errors.\n";
+        return false;
+    }
+
+    spans.resize(ast.size());
+    parent.assign(ast.size(), NO_NODE);
+    linkParents(0);
+    NodeId top = body();
+    for (size_t i = 0; top != NO_NODE && i < ast.numChildren(top); ++i) {
+        backEnd.place(ast.child(top, i), (uint32_t)i);
+        backEnd.edited(ast.child(top, i));
+    }
+    fullBuildNodes = ast.size();
+    patchable = true;
+    return true;
+}
+
+// main's body Block (NO_NODE if the tree has no function)
+NodeId WatchSession::body() const {
+    NodeId fn = ast.child(ast.root, 0);
+    return (fn != NO_NODE && ast.numChildren(fn) > 0) ? ast.child(fn, 0) : NO_NODE;
+}
+
+// Point the children of nodes [from, size) back at them
+void WatchSession::linkParents(size_t from) {
+    parent.resize(ast.size(), NO_NODE);
+    for (NodeId id = (NodeId)from; id < ast.size(); ++id)
+        for (size_t i = 0; i < ast.numChildren(id); ++i) {
+            NodeId c = ast.child(id, i);
+            if (c != NO_NODE) parent[c] = id;
+        }
+}
+
+// Apply the edit that turns text into next. On PATCH_FAILED, `next` still
+// holds the new contents so the caller can build them from scratch.
+WatchSession::Patch WatchSession::patch(string &next, string &summary) {
+    // ---- 1. Changed bytes: old [p, oldEnd) became new [p, newEnd)
+    size_t oldLen = text.size(), newLen = next.size();
+    size_t limit = min(oldLen, newLen);
+    size_t p = mismatch(text.begin(), text.begin() + limit, next.begin()).first - text.begin();
+    size_t s = 0;
+    while (s < limit - p && text[oldLen - 1 - s] == next[newLen - 1 - s]) s++;
+    if (p == oldLen && p == newLen) {
+        summary = "no changes";
+        return PATCH_SAME;
+    }
+    size_t newEnd = newLen - s;
+    ptrdiff_t delta = (ptrdiff_t)newLen - (ptrdiff_t)oldLen;
+
+    // ---- 2. Re-lex from the end of the last token before the edit until a
+    // new token starts where an old one did, past the edit
+    size_t a = partition_point(tokens.begin(), tokens.end(),
+                               [&](const Token &t) { return tokenEnd(t) < p; }) - tokens.begin();
+    size_t from = a ? tokenEnd(tokens[a - 1]) : 0;
+    string lexErrors;
+    Lexer lexer(next, from, &lexErrors);
+    vector<Token> fresh;
+    size_t m = tokens.size();               // old tokens [a, m) are replaced
+    Token tok;
+    while (lexer.next(tok)) {
+        size_t start = tokenStart(tok);
+        if (start >= newEnd) {
+            size_t oldStart = start - delta;
+            auto it = lower_bound(tokens.begin() + a, tokens.end(), oldStart,
+                                  [](const Token &t, size_t off) { return tokenStart(t) < off; });
+            if (it != tokens.end() && tokenStart(*it) == oldStart) {
+                m = it - tokens.begin();
+                break;
+            }
+        }
+        fresh.push_back(tok);
+    }
+    if (lexer.hasErrors()) return PATCH_FAILED;     // the full build reports them
+
+    // ---- 3. Tokens that really changed: old [lo, hi) became fresh [f0, f1)
+    auto same = [&](const Token &o, const Token &n) {
+        return o.kind == n.kind && o.id == n.id && o.length == n.length &&
+               memcmp(text.data() + o.offset, next.data() + n.offset, o.length) == 0;
+    };
+    size_t lo = a, hi = m, f0 = 0, f1 = fresh.size();
+    while (f0 < f1 && lo < hi && same(tokens[lo], fresh[f0])) { lo++; f0++; }
+    while (f0 < f1 && lo < hi && same(tokens[hi - 1], fresh[f1 - 1])) { hi--; f1--; }
+    ptrdiff_t dTok = (ptrdiff_t)(f1 - f0) - (ptrdiff_t)(hi - lo);
+    bool tokensChanged = (lo < hi || f0 < f1);
+
+    // ---- 4. Innermost Block with the changed tokens strictly inside its
+    // braces, then the run of its statements that must be parsed again
+    NodeId block = NO_NODE;
+    size_t i0 = 0, i1 = 0;
+    uint32_t L = (uint32_t)lo, H = (uint32_t)hi;
+    if (tokensChanged) {
+        NodeId cur = body();
+        auto covers = [&](NodeId c) {
+            return c != NO_NODE && spans[c].first <= lo && hi <= spans[c].end;
+        };
+        while (cur != NO_NODE) {
+            size_t first = 0;
+            if (ast.kind(cur) == NodeKind::Block) {
+                if (!(spans[cur].first < lo && hi < spans[cur].end)) break;
+                block = cur;
+                // children are in token order: skip those that end before the change
+                size_t l = 0, r = ast.numChildren(cur);
+                while (l < r) {
+                    size_t mid = (l + r) / 2;
+                    if (spans[ast.child(cur, mid)].end <= lo) l = mid + 1;
+                    else r = mid;
+                }
+                first = l;
+            } else if (ast.kind(cur) == NodeKind::If) {
+                first = 1;                  // then / else statements
+            } else {
+                break;
+            }
+            NodeId down = NO_NODE;
+            for (size_t i = first; i < ast.numChildren(cur) && down == NO_NODE; ++i) {
+                NodeId c = ast.child(cur, i);
+                if (covers(c)) down = c;
+                if (ast.kind(cur) == NodeKind::Block) break;
+            }
+            cur = down;
+        }
+        if (block == NO_NODE) return PATCH_FAILED;
+
+        auto span = [&](size_t i) { return spans[ast.child(block, i)]; };
+        size_t n = ast.numChildren(block);
+        while (i0 < n && span(i0).end <= lo) i0++;
+        if (i0 > 0) i0--;       // an added 'else' may belong to the statement before
+        i1 = i0;
+        while (i1 < n && span(i1).first < hi) i1++;
+        if (i0 < i1) {
+            L = min(L, span(i0).first);
+            H = max(H, span(i1 - 1).end);
+        }
+        // the statement after the range must not be able to extend it
+        if (H < tokens.size() && tokens[H].id == TokenId::KwElse) return PATCH_FAILED;
+    }
+
+    // ---- 5. Commit the new text and tokens; shift what follows the edit
+    tokens.erase(tokens.begin() + a, tokens.begin() + m);
+    tokens.insert(tokens.begin() + a, fresh.begin(), fresh.end());
+    for (size_t i = a + fresh.size(); i < tokens.size(); ++i)
+        tokens[i].offset = (uint32_t)(tokens[i].offset + delta);
+    text.swap(next);
+
+    size_t editBytes = max(newEnd, p) - p;
+    summary = "edit at byte " + to_string(p) + " (" + to_string(editBytes) + " bytes): re-lexed " +
+              to_string(fresh.size()) + " tokens";
+    if (!tokensChanged) {
+        summary += ", tokens unchanged";
+        return PATCH_SAME;
+    }
+
+    for (TokenSpan &sp : spans) {
+        if (sp.first == NO_SPAN) continue;
+        if (sp.first >= hi) sp.first = (uint32_t)(sp.first + dTok);
+        if (sp.end > lo && sp.end >= hi) sp.end = (uint32_t)(sp.end + dTok);
+    }
+
+    // ---- 6. Parse the statement run again and splice it into the block.
+    // On a syntax error the full build reports it (a partial parse would
+    // see a premature end of input), so this parse stays silent.
+    Lexer source(text, 0);
+    uint32_t newH = (uint32_t)(H + dTok);
+    Parser parser(source, tokens.data() + L, tokens.data() + newH, ast);
+    parser.recordSpans(spans, L);
+    parser.silence();
+    size_t firstNew = ast.size();
+    vector<NodeId> stmts = parser.parseStatementList();
+    spans.resize(ast.size());
+    if (parser.hasErrors()) {
+        next = text;
+        return PATCH_FAILED;
+    }
+
+    bool unchanged = (stmts.size() == i1 - i0);
+    for (size_t k = 0; unchanged && k < stmts.size(); ++k)
+        unchanged = sameTree(ast, ast.child(block, i0 + k), stmts[k]);
+
+    // ---- 7. Splice, then tell the back end: top-level statements were
+    // replaced, or the one around the nested block was edited
+    bool topLevel = (block == body());
+    if (topLevel)
+        for (size_t k = i0; k < i1; ++k) backEnd.removed(ast.child(block, k));
+
+    NodeId edited = block;
+    if (stmts.size() == i1 - i0) {
+        for (size_t k = 0; k < stmts.size(); ++k)
+            ast.setChild(block, i0 + k, stmts[k]);
+        linkParents(firstNew);
+        for (NodeId st : stmts) parent[st] = block;
+    } else {
+        // the child count changed: the block gets a new node
+        vector<NodeId> kids;
+        for (size_t i = 0; i < i0; ++i) kids.push_back(ast.child(block, i));
+        kids.insert(kids.end(), stmts.begin(), stmts.end());
+        for (size_t i = i1; i < ast.numChildren(block); ++i) kids.push_back(ast.child(block, i));
+        NodeId nb = ast.add(NodeKind::Block, {}, kids);
+        spans.resize(ast.size());
+        spans[nb] = spans[block];
+        NodeId up = parent[block];
+        for (size_t i = 0; i < ast.numChildren(up); ++i) {
+            if (ast.child(up, i) != block) continue;
+            ast.setChild(up, i, nb);
+            if (up == body() && !topLevel) {
+                // a top-level block: the new node takes its place
+                backEnd.removed(block);
+                backEnd.place(nb, (uint32_t)i);
+            }
+        }
+        linkParents(firstNew);
+        parent[nb] = up;
+        edited = nb;
+    }
+    if (topLevel) {
+        // statements after the run moved if the count changed
+        NodeId top = body();
+        size_t end = (stmts.size() == i1 - i0) ? i0 + stmts.size() : ast.numChildren(top);
+        for (size_t i = i0; i < end; ++i) backEnd.place(ast.child(top, i), (uint32_t)i);
+        for (NodeId st : stmts) backEnd.edited(st);
+    } else if (!unchanged) {
+        NodeId top = edited;
+        while (parent[top] != body()) top = parent[top];
+        backEnd.edited(top);
+    }
+
+    summary += ", re-parsed " + to_string(stmts.size()) + " statement(s) (" +
+               to_string(newH - L) + " tokens)";
+    if (unchanged) {
+        summary += ", AST unchanged";
+        return PATCH_SAME;
+    }
+    return PATCH_CHANGED;
+}
+
+// -----------------------------
+// inotify Loop
+// -----------------------------
+int runWatch(const string &path) {
+    WatchSession session(path);
+    session.rebuild();
+
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0) {
+        cerr << "Error: inotify is not available\n";
+        return 1;
+    }
+
+    // Watch the directory: many editors save by renaming a new file over
+    // the old one, which would end a watch on the file itself
+    size_t slash = path.find_last_of('/');
+    string dir = (slash == string::npos) ? "." : path.substr(0, slash ? slash : 1);
+    string name = (slash == string::npos) ? path : path.substr(slash + 1);
+    if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        cerr << "Error: Could not watch " << dir << "\n";
+        close(fd);
+        return 1;
+    }
+    cout << "[watch] watching " << path << " (Ctrl+C to stop)\n" << flush;
+
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t len = read(fd, buf, sizeof buf);
+        if (len < 0 && errno == EINTR) continue;
+        if (len <= 0) break;
+
+        bool changed = false;
+        for (char *q = buf; q < buf + len;) {
+            const inotify_event *ev = (const inotify_event *)q;
+            if (ev->len > 0 && name == ev->name) changed = true;
+            q += sizeof(inotify_event) + ev->len;
+        }
+        if (changed) session.rebuild();
+    }
+    close(fd);
+    return 0;
+}
+
+#else
+
+int runWatch(const string &path) {
+    (void)path;
+    cerr << "Error: --watch needs inotify and is only available on Linux\n";
+    return 1;
+}
+
+#endif
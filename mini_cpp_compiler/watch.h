@@ -0,0 +1,22 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <string>
+
+// --watch mode: compile `path`, then recompile it every time it is saved.
+// - Each new version is diffed against the previous one; only the tokens
+//   around the edit are re-lexed and only the statements around them are
+//   re-parsed (the rest of the AST is reused). Locating the edit and
+//   shifting the positions of the tokens and statements after it are
+//   still linear, but cheap, passes over the file.
+// - Semantic analysis, ICG, optimization and codegen run per top-level
+//   statement of main and are cached. Only edited statements recompile,
+//   plus later statements that read a name whose declaration changed.
+//   Fragments are optimized alone (no constants or dead code across
+//   statements), so the summary's counts are sums over fragments, not
+//   the -O2 whole-program numbers.
+// - Prints a short summary and the diagnostics of every rebuild.
+// Linux only (inotify). Returns the process exit code.
+int runWatch(const std::string &path);
+
+#endif // WATCH_H
@@ -0,0 +1,131 @@
+#include "x86.h"
+
+using namespace std;
+
+X86Label X86Assembler::newLabel() {
+    labels.push_back(-1);
+    return X86Label{(uint32_t)labels.size() - 1};
+}
+
+void X86Assembler::bind(X86Label l) { labels[l.id] = (int64_t)code.size(); }
+
+void X86Assembler::finish() {
+    for (const Fixup &f : fixups) {
+        int32_t rel = (int32_t)(labels[f.label] - (int64_t)(f.at + 4));
+        for (int k = 0; k < 4; ++k) code[f.at + k] = (uint8_t)(rel >> (8 * k));
+    }
+    fixups.clear();
+}
+
+void X86Assembler::imm32(int32_t v) {
+    for (int k = 0; k < 4; ++k) byte((uint8_t)(v >> (8 * k)));
+}
+
+void X86Assembler::op(bool w, uint8_t reg, X86RM rm, initializer_list<uint8_t> opcode, bool byteReg) {
+    uint8_t base = rm.mem ? (uint8_t)RBP : rm.reg;
+    uint8_t rex = 0x40 | (w ? 8 : 0) | ((reg & 8) >> 1) | ((base & 8) >> 3);
+    // spl/bpl/sil/dil need a REX prefix to be addressed as bytes
+    if (rex != 0x40 || (byteReg && !rm.mem && rm.reg >= 4 && rm.reg < 8)) byte(rex);
+    for (uint8_t b : opcode) byte(b);
+    if (rm.mem) {
+        byte(0x80 | (reg & 7) << 3 | (RBP & 7));    // [rbp + disp32]
+        imm32(rm.disp);
+    } else {
+        byte(0xC0 | (reg & 7) << 3 | (rm.reg & 7));
+    }
+}
+
+void X86Assembler::rel32(X86Label l) {
+    fixups.push_back({code.size(), l.id});
+    imm32(0);
+}
+
+// ---- integer ----
+
+void X86Assembler::mov(X86Reg d, X86RM s) { op(true, d, s, {0x8B}); }
+void X86Assembler::mov(X86RM d, X86Reg s) { op(true, s, d, {0x89}); }
+
+void X86Assembler::movImm(X86Reg d, int64_t v) {
+    if (v == (int32_t)v) {
+        op(true, 0, X86RM::r(d), {0xC7});
+        imm32((int32_t)v);
+    } else if (v == (int64_t)(uint32_t)v) {
+        // mov r32, imm32 clears the upper half
+        if (d >= 8) byte(0x41);
+        byte(0xB8 | (d & 7));
+        imm32((int32_t)(uint32_t)v);
+    } else {
+        byte(0x48 | (d >= 8 ? 1 : 0));
+        byte(0xB8 | (d & 7));
+        for (int k = 0; k < 8; ++k) byte((uint8_t)(v >> (8 * k)));
+    }
+}
+
+void X86Assembler::movImm(X86RM d, int32_t v) {
+    op(true, 0, d, {0xC7});
+    imm32(v);
+}
+
+static const uint8_t ALU_RM[] = {0x03, 0x0B, 0x23, 0x2B, 0x33, 0x3B};   // op r64, r/m64
+static const uint8_t ALU_DIGIT[] = {0, 1, 4, 5, 6, 7};                   // op r/m64, imm (/digit)
+
+void X86Assembler::alu(X86Alu o, X86Reg d, X86RM s) { op(true, d, s, {ALU_RM[(int)o]}); }
+
+void X86Assembler::alu(X86Alu o, X86RM d, int32_t v) {
+    if (v >= -128 && v <= 127) {
+        op(true, ALU_DIGIT[(int)o], d, {0x83});
+        byte((uint8_t)v);
+    } else {
+        op(true, ALU_DIGIT[(int)o], d, {0x81});
+        imm32(v);
+    }
+}
+
+void X86Assembler::imul(X86Reg d, X86RM s) { op(true, d, s, {0x0F, 0xAF}); }
+
+void X86Assembler::imul(X86Reg d, X86RM s, int32_t v) {
+    if (v >= -128 && v <= 127) {
+        op(true, d, s, {0x6B});
+        byte((uint8_t)v);
+    } else {
+        op(true, d, s, {0x69});
+        imm32(v);
+    }
+}
+
+void X86Assembler::cqo() { byte(0x48); byte(0x99); }
+void X86Assembler::idiv(X86RM s) { op(true, 7, s, {0xF7}); }
+void X86Assembler::test(X86Reg a, X86Reg b) { op(true, b, X86RM::r(a), {0x85}); }
+void X86Assembler::setcc(X86Cond cc, X86Reg d) { op(false, 0, X86RM::r(d), {0x0F, (uint8_t)(0x90 | (uint8_t)cc)}, true); }
+void X86Assembler::movzxByte(X86Reg d, X86Reg s) { op(false, d, X86RM::r(s), {0x0F, 0xB6}, true); }
+
+void X86Assembler::push(X86Reg r) {
+    if (r >= 8) byte(0x41);
+    byte(0x50 | (r & 7));
+}
+
+void X86Assembler::pop(X86Reg r) {
+    if (r >= 8) byte(0x41);
+    byte(0x58 | (r & 7));
+}
+
+// ---- scalar double ----
+
+static const uint8_t SSE_OP[] = {0x58, 0x5C, 0x59, 0x5E};   // addsd, subsd, mulsd, divsd
+
+void X86Assembler::movsd(uint8_t d, X86RM s) { byte(0xF2); op(false, d, s, {0x0F, 0x10}); }
+void X86Assembler::movsd(X86RM d, uint8_t s) { byte(0xF2); op(false, s, d, {0x0F, 0x11}); }
+void X86Assembler::sse(X86Sse o, uint8_t d, X86RM s) { byte(0xF2); op(false, d, s, {0x0F, SSE_OP[(int)o]}); }
+void X86Assembler::ucomisd(uint8_t a, X86RM b) { byte(0x66); op(false, a, b, {0x0F, 0x2E}); }
+void X86Assembler::cvtsi2sd(uint8_t d, X86RM s) { byte(0xF2); op(true, d, s, {0x0F, 0x2A}); }
+void X86Assembler::cvttsd2si(X86Reg d, X86RM s) { byte(0xF2); op(true, d, s, {0x0F, 0x2C}); }
+void X86Assembler::movq(uint8_t d, X86Reg s) { byte(0x66); op(true, d, X86RM::r(s), {0x0F, 0x6E}); }
+void X86Assembler::xorpd(uint8_t d, uint8_t s) { byte(0x66); op(false, d, X86RM::r(s), {0x0F, 0x57}); }
+
+// ---- control ----
+
+void X86Assembler::jmp(X86Label l) { byte(0xE9); rel32(l); }
+void X86Assembler::jcc(X86Cond cc, X86Label l) { byte(0x0F); byte(0x80 | (uint8_t)cc); rel32(l); }
+void X86Assembler::call(X86Label l) { byte(0xE8); rel32(l); }
+void X86Assembler::ret() { byte(0xC3); }
+void X86Assembler::syscall() { byte(0x0F); byte(0x05); }
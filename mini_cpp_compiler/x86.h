@@ -0,0 +1,96 @@
+#ifndef X86_H
+#define X86_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+// Minimal x86-64 instruction encoder: just the forms the native backend
+// needs. Integer instructions are 64-bit; memory operands are always
+// [rbp + disp32] (the backend keeps everything in its frame). Jumps and
+// calls take labels and are patched to rel32 in finish().
+
+enum X86Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Condition codes (the low nibble of Jcc / SETcc)
+enum class X86Cond : uint8_t {
+    B = 0x2, AE = 0x3, E = 0x4, NE = 0x5, BE = 0x6, A = 0x7,
+    P = 0xA, NP = 0xB, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF
+};
+
+enum class X86Alu : uint8_t { Add, Or, And, Sub, Xor, Cmp };
+enum class X86Sse : uint8_t { Add, Sub, Mul, Div };
+
+// A register (general-purpose or xmm, by context) or a frame slot
+struct X86RM {
+    bool mem = false;
+    uint8_t reg = 0;
+    int32_t disp = 0;
+
+    static X86RM r(uint8_t n) { X86RM o; o.reg = n; return o; }
+    static X86RM m(int32_t d) { X86RM o; o.mem = true; o.disp = d; return o; }
+    bool isReg(uint8_t n) const { return !mem && reg == n; }
+};
+
+struct X86Label { uint32_t id; };
+
+class X86Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    X86Label newLabel();
+    void bind(X86Label l);
+    // Patch every jump/call to its label; all labels must be bound
+    void finish();
+
+    // ---- integer ----
+    void mov(X86Reg d, X86RM s);                 // d = s
+    void mov(X86RM d, X86Reg s);                 // d = s (d a frame slot)
+    void movImm(X86Reg d, int64_t v);            // d = v (flags untouched)
+    void movImm(X86RM d, int32_t v);             // qword slot = sign-extended v
+    void alu(X86Alu op, X86Reg d, X86RM s);      // d op= s
+    void alu(X86Alu op, X86RM d, int32_t v);     // d op= v
+    void imul(X86Reg d, X86RM s);
+    void imul(X86Reg d, X86RM s, int32_t v);     // d = s * v
+    void cqo();
+    void idiv(X86RM s);                          // rdx:rax / s
+    void test(X86Reg a, X86Reg b);
+    void setcc(X86Cond cc, X86Reg d);            // low byte of d = cc
+    void movzxByte(X86Reg d, X86Reg s);          // d = zero-extended low byte of s
+    void push(X86Reg r);
+    void pop(X86Reg r);
+
+    // ---- scalar double (xmm registers are plain numbers 0..15) ----
+    void movsd(uint8_t d, X86RM s);              // xmm d = s
+    void movsd(X86RM d, uint8_t s);              // slot d = xmm s
+    void sse(X86Sse op, uint8_t d, X86RM s);     // xmm d op= s
+    void ucomisd(uint8_t a, X86RM b);            // flags from a vs b (unordered: ZF=PF=CF=1)
+    void cvtsi2sd(uint8_t d, X86RM s);           // xmm d = (double)s
+    void cvttsd2si(X86Reg d, X86RM s);           // d = (int64_t)xmm s, truncating
+    void movq(uint8_t d, X86Reg s);              // xmm d = bits of s
+    void xorpd(uint8_t d, uint8_t s);
+
+    // ---- control ----
+    void jmp(X86Label l);
+    void jcc(X86Cond cc, X86Label l);
+    void call(X86Label l);
+    void ret();
+    void syscall();
+
+private:
+    struct Fixup { size_t at; uint32_t label; };   // rel32 field at `at`
+    std::vector<int64_t> labels;                   // position, -1 if unbound
+    std::vector<Fixup> fixups;
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void imm32(int32_t v);
+    // REX prefix (when needed), opcode bytes, ModRM (+ disp32)
+    void op(bool w, uint8_t reg, X86RM rm, std::initializer_list<uint8_t> opcode, bool byteReg = false);
+    void rel32(X86Label l);
+};
+
+#endif // X86_H